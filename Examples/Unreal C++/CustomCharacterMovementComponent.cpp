@@ -3,31 +3,287 @@
 
 #include "Base/CustomCharacterMovementComponent.h"
 #include "GameFramework/Character.h"
+#include "Player/PlayerBase.h"
+
+DEFINE_LOG_CATEGORY(LogCustomCharacterMovement);
+
+DECLARE_STATS_GROUP(TEXT("CustomMovement"), STATGROUP_CustomMovement, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("PhysCustom"), STAT_PhysCustom, STATGROUP_CustomMovement);
+DECLARE_CYCLE_STAT(TEXT("PhysWalking"), STAT_PhysWalking, STATGROUP_CustomMovement);
+DECLARE_CYCLE_STAT(TEXT("PhysSlide"), STAT_PhysSlide, STATGROUP_CustomMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("PhysCustom Sweeps"), STAT_PhysCustomSweeps, STATGROUP_CustomMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("PhysCustom Teleports"), STAT_PhysCustomTeleports, STATGROUP_CustomMovement);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Input To Movement (ms)"), STAT_InputToMovementMs, STATGROUP_CustomMovement);
+
+// Toggle for comparing sweep counts with and without the clear corridor fast path (stat CustomMovement)
+static TAutoConsoleVariable<bool> CVarCustomMovementFastPath(
+	TEXT("HordeShooter.CustomMovementFastPath"),
+	true,
+	TEXT("Allow custom movement modes to skip sweeping through corridors that are already validated clear."));
+
+UCustomCharacterMovementComponent::UCustomCharacterMovementComponent(const FObjectInitializer& ObjectInitializer) :
+	Super(ObjectInitializer)
+{
+	SetNetworkMoveDataContainer(CustomNetworkMoveDataContainer);
+
+	// Register custom movement modes
+	TUniquePtr<FLedgeGrabMovementMode> LedgeGrab = MakeUnique<FLedgeGrabMovementMode>();
+	LedgeGrabMode = LedgeGrab.Get();
+	RegisterCustomMovementMode(CMOVE_LedgeGrab, MoveTemp(LedgeGrab));
+	RegisterCustomMovementMode(CMOVE_Slide, MakeUnique<FSlideMovementMode>());
+}
 
 void UCustomCharacterMovementComponent::PhysCustom(float deltaTime, int32 Iterations)
 {
-	Super::PhysCustom(deltaTime, Iterations);
-	
-	if (deltaTime < MIN_TICK_TIME)
+	SCOPE_CYCLE_COUNTER(STAT_PhysCustom);
+	CONDITIONAL_SCOPE_CYCLE_COUNTER(STAT_PhysSlide, CustomMovementMode == CMOVE_Slide);
+
+	FCustomMovementMode* Handler = GetCustomMovementModeHandler(CustomMovementMode);
+	if (!Handler)
+	{
+		UE_LOG(LogCustomCharacterMovement, Error, TEXT("'%s' Invalid Custom Movement Mode %d!"), *GetNameSafe(CharacterOwner), CustomMovementMode);
+		SetMovementMode(MOVE_Walking);
+		return;
+	}
+
+	Handler->Phys(*this, deltaTime, Iterations);
+}
+
+void UCustomCharacterMovementComponent::PhysWalking(float deltaTime, int32 Iterations)
+{
+	// Measured next to PhysSlide so both ground modes can be compared (stat CustomMovement)
+	SCOPE_CYCLE_COUNTER(STAT_PhysWalking);
+	Super::PhysWalking(deltaTime, Iterations);
+}
+
+void UCustomCharacterMovementComponent::UpdateCharacterStateBeforeMovement(float DeltaSeconds)
+{
+	// Blockers only stop crouches and slides from starting, ones already under way end normally
+	if (IsBlocked(EPlayerBlocker::Crouch) && !IsCrouching())
+	{
+		bWantsToCrouch = false;
+	}
+
+	// Slides start and stop as part of the move so the server and client replays make the same call
+	const bool bIsSliding = IsSliding();
+	const bool bSlideBlocked = IsBlocked(EPlayerBlocker::Slide) || IsBlocked(EPlayerBlocker::Crouch);
+	if (bWantsToSlide && !bIsSliding && !bSlideBlocked && IsMovingOnGround() && Velocity.SizeSquared() >= FMath::Square(SlideMinEnterSpeed))
+	{
+		SetMovementMode(MOVE_Custom, CMOVE_Slide);
+	}
+	else if (!bWantsToSlide && bIsSliding)
+	{
+		SetMovementMode(MOVE_Walking);
+	}
+
+	Super::UpdateCharacterStateBeforeMovement(DeltaSeconds);
+}
+
+bool UCustomCharacterMovementComponent::IsMovingOnGround() const
+{
+	// Sliding is on the ground as far as crouching, jumping and basing are concerned
+	return Super::IsMovingOnGround() || (IsSliding() && UpdatedComponent);
+}
+
+float UCustomCharacterMovementComponent::GetMaxSpeed() const
+{
+	// Speed modifiers only apply to the walking speeds, custom movement modes have their own
+	if (MovementMode != MOVE_Walking && MovementMode != MOVE_NavWalking && MovementMode != MOVE_Falling)
+	{
+		return Super::GetMaxSpeed();
+	}
+
+	const float MaxSpeed = Super::GetMaxSpeed() * SpeedScale;
+	return IsSprinting() ? MaxSpeed * SprintSpeedMultiplier : MaxSpeed;
+}
+
+bool UCustomCharacterMovementComponent::IsSprinting() const
+{
+	return bWantsToSprint && IsMovingOnGround() && !IsCrouching() && !IsBlocked(EPlayerBlocker::Sprint) && !IsBlocked(EPlayerBlocker::Movement);
+}
+
+FVector UCustomCharacterMovementComponent::ConstrainInputAcceleration(const FVector& InputAcceleration) const
+{
+	if (IsBlocked(EPlayerBlocker::Movement))
+	{
+		return FVector::ZeroVector;
+	}
+
+	return Super::ConstrainInputAcceleration(InputAcceleration);
+}
+
+void UCustomCharacterMovementComponent::UpdateFromCompressedFlags(uint8 Flags)
+{
+	Super::UpdateFromCompressedFlags(Flags);
+	bWantsToSlide = (Flags & FSavedMove_Character::FLAG_Custom_0) != 0;
+	bWantsToSprint = (Flags & FSavedMove_Character::FLAG_Custom_1) != 0;
+}
+
+FNetworkPredictionData_Client* UCustomCharacterMovementComponent::GetPredictionData_Client() const
+{
+	if (ClientPredictionData == nullptr)
+	{
+		UCustomCharacterMovementComponent* MutableThis = const_cast<UCustomCharacterMovementComponent*>(this);
+		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_Custom(*this);
+	}
+
+	return ClientPredictionData;
+}
+
+void UCustomCharacterMovementComponent::MoveAutonomous(float ClientTimeStamp, float DeltaTime, uint8 CompressedFlags, const FVector& NewAccel)
+{
+	// Apply the input and state the client sent with this move before simulating it
+	if (const FCustomNetworkMoveData* MoveData = static_cast<const FCustomNetworkMoveData*>(GetCurrentNetworkMoveData()))
+	{
+		InputBits = MoveData->InputBits;
+		BlockerMask = MoveData->BlockerMask;
+		if (APlayerBase* Player = Cast<APlayerBase>(CharacterOwner))
+		{
+			Player->ApplyClientLocomotionState(MoveData->LocomotionState);
+		}
+	}
+
+	Super::MoveAutonomous(ClientTimeStamp, DeltaTime, CompressedFlags, NewAccel);
+}
+
+void UCustomCharacterMovementComponent::PerformMovement(float DeltaTime)
+{
+	// Time from the buffered press that triggered this move to it being simulated
+	if (PendingInputTimestamp > 0.0)
 	{
+		SET_FLOAT_STAT(STAT_InputToMovementMs, (FPlatformTime::Seconds() - PendingInputTimestamp) * 1000.0);
+		PendingInputTimestamp = 0.0;
+	}
+
+	// Advanced by the move's own delta time, jump checks for this move already happened
+	if (IsFalling())
+	{
+		TimeSinceLeftGround += DeltaTime;
+	}
+
+	Super::PerformMovement(DeltaTime);
+}
+
+void UCustomCharacterMovementComponent::OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode)
+{
+	if (PreviousMovementMode == MOVE_Custom)
+	{
+		if (FCustomMovementMode* Handler = GetCustomMovementModeHandler(PreviousCustomMode))
+		{
+			Handler->OnExit(*this);
+		}
+	}
+
+	if (MovementMode == MOVE_Custom)
+	{
+		if (FCustomMovementMode* Handler = GetCustomMovementModeHandler(CustomMovementMode))
+		{
+			Handler->OnEnter(*this);
+		}
+	}
+
+	// Start the coyote time window when walking off the ground, landing allows the next one
+	if (IsFalling() && (PreviousMovementMode == MOVE_Walking || PreviousMovementMode == MOVE_NavWalking))
+	{
+		TimeSinceLeftGround = 0.0f;
+	}
+	else if (IsMovingOnGround())
+	{
+		bJumpedSinceGrounded = false;
+	}
+
+	Super::OnMovementModeChanged(PreviousMovementMode, PreviousCustomMode);
+}
+
+void UCustomCharacterMovementComponent::ResetCoyoteTime()
+{
+	TimeSinceLeftGround = 0.0f;
+	bJumpedSinceGrounded = false;
+}
+
+void UCustomCharacterMovementComponent::SetLedgeGrabCorridorClear(bool bClear)
+{
+	LedgeGrabMode->bCorridorClear = bClear;
+}
+
+/**
+ * --------------------
+ * - Custom Movement Modes
+ * --------------------
+ */
+#pragma region CUSTOM_MOVEMENT_MODES
+void UCustomCharacterMovementComponent::RegisterCustomMovementMode(uint8 Mode, TUniquePtr<FCustomMovementMode> Handler)
+{
+	if (Mode == CMOVE_None || Mode >= CMOVE_MAX)
+	{
+		UE_LOG(LogCustomCharacterMovement, Error, TEXT("'%s' Cannot register Custom Movement Mode %d!"), *GetNameSafe(this), Mode);
 		return;
 	}
 
+	CustomMovementModes[Mode] = MoveTemp(Handler);
+}
+
+FCustomMovementMode* UCustomCharacterMovementComponent::GetCustomMovementModeHandler(uint8 Mode) const
+{
+	return Mode < CMOVE_MAX ? CustomMovementModes[Mode].Get() : nullptr;
+}
+
+void UCustomCharacterMovementComponent::ApplyCustomVelocity(float deltaTime, const FVector& NewVelocity)
+{
 	RestorePreAdditiveRootMotionVelocity();
 
 	if( !HasAnimRootMotion() && !CurrentRootMotion.HasOverrideVelocity() )
 	{
-		if( bCheatFlying && Acceleration.IsZero() )
+		Velocity = NewVelocity;
+	}
+
+	ApplyRootMotionToVelocity(deltaTime);
+}
+
+void UCustomCharacterMovementComponent::MoveAlongCustomVelocity(float deltaTime, int32 Iterations, bool bCanSkipSweep)
+{
+	// Split fast moves into substeps of at most one capsule radius so they cannot tunnel through geometry
+	const float SubstepDistance = FMath::Max(GetPawnCapsuleExtent(SHRINK_None).X, UE_KINDA_SMALL_NUMBER);
+	const int32 NumSubsteps = FMath::Clamp(FMath::CeilToInt((Velocity.Size() * deltaTime) / SubstepDistance), 1, MaxCustomSubsteps);
+	const float SubstepTime = deltaTime / NumSubsteps;
+	bCanSkipSweep &= CVarCustomMovementFastPath.GetValueOnGameThread();
+
+	for (int32 Substep = 0; Substep < NumSubsteps; Substep++)
+	{
+		Iterations++;
+		bJustTeleported = false;
+
+		if (!bCanSkipSweep || !TeleportCustomMove(Velocity * SubstepTime))
 		{
-			Velocity = FVector::ZeroVector;
+			SweepCustomMove(SubstepTime);
 		}
-		Velocity = Acceleration;
 	}
+}
 
-	ApplyRootMotionToVelocity(deltaTime);
+bool UCustomCharacterMovementComponent::TeleportCustomMove(const FVector& Delta)
+{
+	// Anything not covered by the corridor validation (other pawns, movers) still blocks the move
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(CustomMoveEncroachment), false, CharacterOwner);
+	FCollisionResponseParams ResponseParams;
+	InitCollisionParams(QueryParams, ResponseParams);
 
-	Iterations++;
-	bJustTeleported = false;
+	const FVector NewLocation = UpdatedComponent->GetComponentLocation() + Delta;
+	const FQuat Rotation = UpdatedComponent->GetComponentQuat();
+	if (GetWorld()->OverlapBlockingTestByChannel(NewLocation, Rotation, UpdatedComponent->GetCollisionObjectType(), GetPawnCapsuleCollisionShape(SHRINK_None), QueryParams, ResponseParams))
+	{
+		return false;
+	}
+
+	INC_DWORD_STAT(STAT_PhysCustomTeleports);
+	MoveUpdatedComponent(Delta, Rotation, false);
+
+	// Velocity is unchanged, the full delta was applied
+	return true;
+}
+
+void UCustomCharacterMovementComponent::SweepCustomMove(float deltaTime)
+{
+	INC_DWORD_STAT(STAT_PhysCustomSweeps);
 
 	FVector OldLocation = UpdatedComponent->GetComponentLocation();
 	const FVector Adjusted = Velocity * deltaTime;
@@ -63,4 +319,216 @@ void UCustomCharacterMovementComponent::PhysCustom(float deltaTime, int32 Iterat
 	{
 		Velocity = (UpdatedComponent->GetComponentLocation() - OldLocation) / deltaTime;
 	}
-}
\ No newline at end of file
+}
+
+bool UCustomCharacterMovementComponent::UpdateCustomFloor()
+{
+	FindFloor(UpdatedComponent->GetComponentLocation(), CurrentFloor, false);
+	if (!CurrentFloor.IsWalkableFloor())
+	{
+		return false;
+	}
+
+	AdjustFloorHeight();
+	SetBaseFromFloor(CurrentFloor);
+	return true;
+}
+#pragma endregion
+
+void UCustomCharacterMovementComponent::OnClientCorrectionReceived(FNetworkPredictionData_Client_Character& ClientData, float TimeStamp, FVector NewLocation, FVector NewVelocity, UPrimitiveComponent* NewBase, FName NewBaseBoneName, bool bHasBase, bool bBaseRelativePosition, uint8 ServerMovementMode, FVector ServerGravityDirection)
+{
+	const FVector ClientLocation = UpdatedComponent->GetComponentLocation();
+	Super::OnClientCorrectionReceived(ClientData, TimeStamp, NewLocation, NewVelocity, NewBase, NewBaseBoneName, bHasBase, bBaseRelativePosition, ServerMovementMode, ServerGravityDirection);
+	NumClientCorrections++;
+
+	// Recorded after the correction is applied, NewLocation may be relative to a base
+	if (FMovementCorrectionLog::Get().IsOpen())
+	{
+		const FVector ServerLocation = UpdatedComponent->GetComponentLocation();
+		RecordCorrection(EMovementCorrectionRecordType::Client, TimeStamp, ServerLocation, ClientLocation - ServerLocation);
+	}
+}
+
+bool UCustomCharacterMovementComponent::ServerCheckClientError(float ClientTimeStamp, float DeltaTime, const FVector& Accel, const FVector& ClientWorldLocation, const FVector& RelativeClientLocation, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode)
+{
+	const bool bNeedsCorrection = Super::ServerCheckClientError(ClientTimeStamp, DeltaTime, Accel, ClientWorldLocation, RelativeClientLocation, ClientMovementBase, ClientBaseBoneName, ClientMovementMode);
+	if (bNeedsCorrection && FMovementCorrectionLog::Get().IsOpen())
+	{
+		const FVector ServerLocation = UpdatedComponent->GetComponentLocation();
+		RecordCorrection(EMovementCorrectionRecordType::Server, ClientTimeStamp, ServerLocation, ClientWorldLocation - ServerLocation);
+	}
+	return bNeedsCorrection;
+}
+
+void UCustomCharacterMovementComponent::RecordCorrection(EMovementCorrectionRecordType Type, float ClientTimeStamp, const FVector& ServerLocation, const FVector& LocationError) const
+{
+	FMovementCorrectionRecord Record;
+	Record.Type = Type;
+	Record.Time = GetWorld()->GetTimeSeconds();
+	Record.ClientTimeStamp = ClientTimeStamp;
+	Record.Location = FVector3f(ServerLocation);
+	Record.LocationError = FVector3f(LocationError);
+	Record.MovementMode = MovementMode;
+	Record.CustomMovementMode = CustomMovementMode;
+	if (const APlayerBase* Player = Cast<APlayerBase>(CharacterOwner))
+		Player->FillCorrectionRecord(Record);
+
+	FMovementCorrectionLog::Get().Push(Record);
+}
+
+/**
+ * --------------------
+ * - Prediction
+ * --------------------
+ */
+#pragma region PREDICTION
+void FSavedMove_Custom::Clear()
+{
+	Super::Clear();
+	SavedCustomMovementMode = CMOVE_None;
+	ModeMoveData = FCustomMovementModeMoveData();
+	SavedInputBits = 0;
+	SavedBlockerMask = 0;
+	SavedLocomotionState = EPlayerLocomotionState::Idle;
+	bSavedWantsToSlide = false;
+	bSavedWantsToSprint = false;
+	SavedTimeSinceLeftGround = 0.0f;
+	bSavedJumpedSinceGrounded = false;
+}
+
+void FSavedMove_Custom::SetMoveFor(ACharacter* C, float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData)
+{
+	Super::SetMoveFor(C, InDeltaTime, NewAccel, ClientData);
+
+	const UCustomCharacterMovementComponent* Movement = CastChecked<UCustomCharacterMovementComponent>(C->GetCharacterMovement());
+	SavedInputBits = Movement->GetInputBits();
+	SavedBlockerMask = Movement->GetBlockerMask();
+	SavedLocomotionState = Movement->GetLocomotionState();
+	bSavedWantsToSlide = Movement->GetWantsToSlide();
+	bSavedWantsToSprint = Movement->GetWantsToSprint();
+	SavedTimeSinceLeftGround = Movement->TimeSinceLeftGround;
+	bSavedJumpedSinceGrounded = Movement->bJumpedSinceGrounded;
+	SavedCustomMovementMode = Movement->MovementMode == MOVE_Custom ? Movement->CustomMovementMode : CMOVE_None;
+	if (const FCustomMovementMode* Handler = Movement->GetCustomMovementModeHandler(SavedCustomMovementMode))
+	{
+		Handler->SaveMove(*Movement, ModeMoveData);
+	}
+}
+
+void FSavedMove_Custom::PrepMoveFor(ACharacter* C)
+{
+	Super::PrepMoveFor(C);
+
+	UCustomCharacterMovementComponent* Movement = CastChecked<UCustomCharacterMovementComponent>(C->GetCharacterMovement());
+	Movement->TimeSinceLeftGround = SavedTimeSinceLeftGround;
+	Movement->bJumpedSinceGrounded = bSavedJumpedSinceGrounded;
+	if (FCustomMovementMode* Handler = Movement->GetCustomMovementModeHandler(SavedCustomMovementMode))
+	{
+		Handler->PrepMove(*Movement, ModeMoveData);
+	}
+}
+
+bool FSavedMove_Custom::CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const
+{
+	const FSavedMove_Custom* NewCustomMove = static_cast<const FSavedMove_Custom*>(NewMove.Get());
+	if (SavedCustomMovementMode != NewCustomMove->SavedCustomMovementMode || SavedInputBits != NewCustomMove->SavedInputBits || SavedBlockerMask != NewCustomMove->SavedBlockerMask || bSavedWantsToSlide != NewCustomMove->bSavedWantsToSlide || bSavedWantsToSprint != NewCustomMove->bSavedWantsToSprint)
+	{
+		return false;
+	}
+
+	const UCustomCharacterMovementComponent* Movement = CastChecked<UCustomCharacterMovementComponent>(InCharacter->GetCharacterMovement());
+	const FCustomMovementMode* Handler = Movement->GetCustomMovementModeHandler(SavedCustomMovementMode);
+	if (Handler && !Handler->CanCombineMoves(ModeMoveData, NewCustomMove->ModeMoveData))
+	{
+		return false;
+	}
+
+	return Super::CanCombineWith(NewMove, InCharacter, MaxDelta);
+}
+
+uint8 FSavedMove_Custom::GetCompressedFlags() const
+{
+	uint8 Result = Super::GetCompressedFlags();
+	if (bSavedWantsToSlide)
+	{
+		Result |= FLAG_Custom_0;
+	}
+	if (bSavedWantsToSprint)
+	{
+		Result |= FLAG_Custom_1;
+	}
+	return Result;
+}
+
+FSavedMovePtr FNetworkPredictionData_Client_Custom::AllocateNewMove()
+{
+	return FSavedMovePtr(new FSavedMove_Custom());
+}
+
+void FCustomNetworkMoveData::ClientFillNetworkMoveData(const FSavedMove_Character& ClientMove, ENetworkMoveType MoveType)
+{
+	Super::ClientFillNetworkMoveData(ClientMove, MoveType);
+
+	const FSavedMove_Custom& CustomMove = static_cast<const FSavedMove_Custom&>(ClientMove);
+	InputBits = CustomMove.SavedInputBits;
+	BlockerMask = CustomMove.SavedBlockerMask;
+	LocomotionState = CustomMove.SavedLocomotionState;
+}
+
+bool FCustomNetworkMoveData::Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap, ENetworkMoveType MoveType)
+{
+	Super::Serialize(CharacterMovement, Ar, PackageMap, MoveType);
+
+	// Moves without any held input only cost one bit
+	uint8 bHasInputBits = InputBits != 0;
+	Ar.SerializeBits(&bHasInputBits, 1);
+	if (bHasInputBits)
+	{
+		Ar << InputBits;
+	}
+	else
+	{
+		InputBits = 0;
+	}
+
+	// Blockers are rare, so usually one bit as well
+	uint8 bHasBlockerMask = BlockerMask != 0;
+	Ar.SerializeBits(&bHasBlockerMask, 1);
+	if (bHasBlockerMask)
+	{
+		Ar << BlockerMask;
+	}
+	else
+	{
+		BlockerMask = 0;
+	}
+
+	// Idle, the most common state, costs one bit
+	uint8 State = static_cast<uint8>(LocomotionState);
+	uint8 bHasLocomotionState = LocomotionState != EPlayerLocomotionState::Idle;
+	Ar.SerializeBits(&bHasLocomotionState, 1);
+	if (bHasLocomotionState)
+	{
+		Ar << State;
+	}
+	else
+	{
+		State = static_cast<uint8>(EPlayerLocomotionState::Idle);
+	}
+	if (State >= static_cast<uint8>(EPlayerLocomotionState::MAX))
+	{
+		// Never trust a state outside the enum
+		Ar.SetError();
+		return false;
+	}
+	LocomotionState = static_cast<EPlayerLocomotionState>(State);
+	return !Ar.IsError();
+}
+
+FCustomNetworkMoveDataContainer::FCustomNetworkMoveDataContainer()
+{
+	NewMoveData = &CustomMoveData[0];
+	PendingMoveData = &CustomMoveData[1];
+	OldMoveData = &CustomMoveData[2];
+}
+#pragma endregion
\ No newline at end of file
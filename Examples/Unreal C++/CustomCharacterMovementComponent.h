@@ -4,8 +4,76 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/CharacterMovementComponent.h"
+#include "Base/CustomMovementMode.h"
+#include "Base/MovementCorrectionLog.h"
+#include "Player/PlayerBlockers.h"
 #include "CustomCharacterMovementComponent.generated.h"
 
+class UCurveFloat;
+enum class EPlayerLocomotionState : uint8;
+
+DECLARE_LOG_CATEGORY_EXTERN(LogCustomCharacterMovement, Log, All);
+
+UENUM(BlueprintType)
+enum ECustomMovementMode : uint8
+{
+	CMOVE_None UMETA(Hidden),
+	CMOVE_LedgeGrab UMETA(DisplayName = "Ledge Grab"),
+	CMOVE_Slide UMETA(DisplayName = "Slide"),
+	CMOVE_MAX UMETA(Hidden),
+};
+
+class HORDESHOOTER_API FSavedMove_Custom : public FSavedMove_Character
+{
+	typedef FSavedMove_Character Super;
+
+public:
+	virtual void Clear() override;
+	virtual void SetMoveFor(ACharacter* C, float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData) override;
+	virtual void PrepMoveFor(ACharacter* C) override;
+	virtual bool CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const override;
+	virtual uint8 GetCompressedFlags() const override;
+
+	uint8 SavedCustomMovementMode = CMOVE_None;
+	FCustomMovementModeMoveData ModeMoveData;
+	uint16 SavedInputBits = 0;
+	FPlayerBlockerMask SavedBlockerMask = 0;
+	EPlayerLocomotionState SavedLocomotionState{};
+	bool bSavedWantsToSlide = false;
+	bool bSavedWantsToSprint = false;
+	float SavedTimeSinceLeftGround = 0.0f;
+	bool bSavedJumpedSinceGrounded = false;
+};
+
+class HORDESHOOTER_API FNetworkPredictionData_Client_Custom : public FNetworkPredictionData_Client_Character
+{
+	typedef FNetworkPredictionData_Client_Character Super;
+
+public:
+	FNetworkPredictionData_Client_Custom(const UCharacterMovementComponent& ClientMovement) : Super(ClientMovement) {}
+
+	virtual FSavedMovePtr AllocateNewMove() override;
+};
+
+struct HORDESHOOTER_API FCustomNetworkMoveData : public FCharacterNetworkMoveData
+{
+	typedef FCharacterNetworkMoveData Super;
+
+	virtual void ClientFillNetworkMoveData(const FSavedMove_Character& ClientMove, ENetworkMoveType MoveType) override;
+	virtual bool Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap, ENetworkMoveType MoveType) override;
+
+	uint16 InputBits = 0;
+	FPlayerBlockerMask BlockerMask = 0;
+	EPlayerLocomotionState LocomotionState{};
+};
+
+struct HORDESHOOTER_API FCustomNetworkMoveDataContainer : public FCharacterNetworkMoveDataContainer
+{
+	FCustomNetworkMoveDataContainer();
+
+	FCustomNetworkMoveData CustomMoveData[3];
+};
+
 /**
  * 
  */
@@ -15,5 +83,141 @@ class HORDESHOOTER_API UCustomCharacterMovementComponent : public UCharacterMove
 	GENERATED_BODY()
 	
 public:
+	UCustomCharacterMovementComponent(const FObjectInitializer& ObjectInitializer);
+
 	virtual void PhysCustom(float deltaTime, int32 Iterations) override;
+	virtual void UpdateCharacterStateBeforeMovement(float DeltaSeconds) override;
+	virtual bool IsMovingOnGround() const override;
+	virtual float GetMaxSpeed() const override;
+	virtual FVector ConstrainInputAcceleration(const FVector& InputAcceleration) const override;
+	virtual FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+	virtual void MoveAutonomous(float ClientTimeStamp, float DeltaTime, uint8 CompressedFlags, const FVector& NewAccel) override;
+	virtual void OnClientCorrectionReceived(FNetworkPredictionData_Client_Character& ClientData, float TimeStamp, FVector NewLocation, FVector NewVelocity, UPrimitiveComponent* NewBase, FName NewBaseBoneName, bool bHasBase, bool bBaseRelativePosition, uint8 ServerMovementMode, FVector ServerGravityDirection) override;
+	virtual bool ServerCheckClientError(float ClientTimeStamp, float DeltaTime, const FVector& Accel, const FVector& ClientWorldLocation, const FVector& RelativeClientLocation, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode) override;
+
+	int32 GetNumClientCorrections() const { return NumClientCorrections; }
+
+	// Set once the ledge grab path has been validated clear so it can move without sweeping
+	void SetLedgeGrabCorridorClear(bool bClear);
+
+	// Time of the buffered input press that caused the next move, used to measure input to movement latency
+	void SetPendingInputTimestamp(double Timestamp) { PendingInputTimestamp = Timestamp; }
+
+	// Held input actions of the owning pawn packed one bit per action, sent with every move
+	void SetInputBits(uint16 Bits) { InputBits = Bits; }
+	uint16 GetInputBits() const { return InputBits; }
+
+	// Locomotion state of the owning client, sent with every move so a lost move cannot leave the server on an old state
+	void SetLocomotionState(EPlayerLocomotionState State) { LocomotionState = State; }
+	EPlayerLocomotionState GetLocomotionState() const { return LocomotionState; }
+
+	// Blockers the owning client predicted, sent with every move so the server enforces them as well
+	void SetBlockerMask(FPlayerBlockerMask Mask) { BlockerMask = Mask; }
+	FPlayerBlockerMask GetBlockerMask() const { return BlockerMask; }
+	// Blockers the server holds, replicated to the owning client by the pawn
+	void SetServerBlockerMask(FPlayerBlockerMask Mask) { ServerBlockerMask = Mask; }
+	FPlayerBlockerMask GetEffectiveBlockerMask() const { return BlockerMask | ServerBlockerMask; }
+	bool IsBlocked(EPlayerBlocker BlockerType) const { return (GetEffectiveBlockerMask() & PlayerBlockers::GetBit(BlockerType)) != 0; }
+
+	// Product of the pawn's speed modifiers, scales walking and falling speeds
+	void SetSpeedScale(float Scale) { SpeedScale = Scale; }
+	float GetSpeedScale() const { return SpeedScale; }
+
+	// Sprinting scales walking speed on the ground, while neither movement nor sprinting is blocked
+	void SetWantsToSprint(bool bWants) { bWantsToSprint = bWants; }
+	bool GetWantsToSprint() const { return bWantsToSprint; }
+	void SetSprintSpeedMultiplier(float Multiplier) { SprintSpeedMultiplier = Multiplier; }
+	bool IsSprinting() const;
+
+	// Coyote time, measured in move time so the server and client replays agree on it
+	void NotifyJumped() { bJumpedSinceGrounded = true; }
+	bool CanCoyoteJump(float CoyoteTime) const { return IsFalling() && !bJumpedSinceGrounded && TimeSinceLeftGround <= CoyoteTime; }
+	void ResetCoyoteTime();
+
+	// Slides start on the next move once the character is on the ground and fast enough, and stop when this is cleared
+	void SetWantsToSlide(bool bWants) { bWantsToSlide = bWants; }
+	bool GetWantsToSlide() const { return bWantsToSlide; }
+	bool IsSliding() const { return MovementMode == MOVE_Custom && CustomMovementMode == CMOVE_Slide; }
+
+	// Custom movement mode registry
+public:
+	void RegisterCustomMovementMode(uint8 Mode, TUniquePtr<FCustomMovementMode> Handler);
+	FCustomMovementMode* GetCustomMovementModeHandler(uint8 Mode) const;
+
+	// Building blocks for custom movement modes
+public:
+	void ApplyCustomVelocity(float deltaTime, const FVector& NewVelocity);
+	void MoveAlongCustomVelocity(float deltaTime, int32 Iterations, bool bCanSkipSweep);
+	// Refreshes CurrentFloor and keeps the capsule at walking height above it, false if there is no walkable floor
+	bool UpdateCustomFloor();
+
+	// Slide
+public:
+	// Slower than this and a slide will not start
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Character Movement: Slide", meta = (ClampMin = 0, UIMin = 0, ForceUnits = "cm/s"))
+	float SlideMinEnterSpeed = 400.0f;
+
+	// The slide ends once it drops below this speed
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Character Movement: Slide", meta = (ClampMin = 0, UIMin = 0, ForceUnits = "cm/s"))
+	float SlideExitSpeed = 250.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Character Movement: Slide", meta = (ClampMin = 0, UIMin = 0, ForceUnits = "cm/s"))
+	float SlideEnterImpulse = 300.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Character Movement: Slide", meta = (ClampMin = 0, UIMin = 0, ForceUnits = "cm/s"))
+	float SlideMaxSpeed = 1600.0f;
+
+	// How strongly gravity pulls along the floor, speeding slides up downhill and slowing them uphill
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Character Movement: Slide", meta = (ClampMin = 0, UIMin = 0))
+	float SlideGravityScale = 1.0f;
+
+	// Friction by seconds into the slide, SlideFriction is used without a curve
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Character Movement: Slide")
+	UCurveFloat* SlideFrictionCurve = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Character Movement: Slide", meta = (ClampMin = 0, UIMin = 0))
+	float SlideFriction = 1.3f;
+
+	// Fraction of the input acceleration applied sideways to steer a slide
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Character Movement: Slide", meta = (ClampMin = 0, UIMin = 0))
+	float SlideSteeringScale = 0.25f;
+
+protected:
+	virtual void PerformMovement(float DeltaTime) override;
+	virtual void PhysWalking(float deltaTime, int32 Iterations) override;
+	virtual void UpdateFromCompressedFlags(uint8 Flags) override;
+	virtual void OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode) override;
+
+private:
+	// Saved moves save and restore the coyote time state directly
+	friend class FSavedMove_Custom;
+
+	void RecordCorrection(EMovementCorrectionRecordType Type, float ClientTimeStamp, const FVector& ServerLocation, const FVector& LocationError) const;
+	bool TeleportCustomMove(const FVector& Delta);
+	void SweepCustomMove(float deltaTime);
+
+protected:
+	// Upper limit on the substeps a custom movement mode splits a fast move into, each substep moves at most one capsule radius
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Character Movement: Custom Movement", meta = (ClampMin = 1, UIMin = 1))
+	int32 MaxCustomSubsteps = 4;
+
+private:
+	// Indexed by CustomMovementMode
+	TStaticArray<TUniquePtr<FCustomMovementMode>, CMOVE_MAX> CustomMovementModes;
+	// Owned by CustomMovementModes, kept typed for the state machine's corridor flag
+	FLedgeGrabMovementMode* LedgeGrabMode = nullptr;
+	FCustomNetworkMoveDataContainer CustomNetworkMoveDataContainer;
+	int32 NumClientCorrections = 0;
+	double PendingInputTimestamp = 0.0;
+	uint16 InputBits = 0;
+	EPlayerLocomotionState LocomotionState{};
+	FPlayerBlockerMask BlockerMask = 0;
+	FPlayerBlockerMask ServerBlockerMask = 0;
+	float SpeedScale = 1.0f;
+	float SprintSpeedMultiplier = 1.0f;
+	bool bWantsToSlide = false;
+	bool bWantsToSprint = false;
+	// Move time spent falling since walking off the ground, and whether a jump happened since
+	float TimeSinceLeftGround = 0.0f;
+	bool bJumpedSinceGrounded = false;
 };
@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Base/CustomMovementMode.h"
+#include "Base/CustomCharacterMovementComponent.h"
+#include "Curves/CurveFloat.h"
+
+/**
+ * --------------------
+ * - Ledge Grab
+ * --------------------
+ */
+#pragma region LEDGE_GRAB
+void FLedgeGrabMovementMode::OnExit(UCustomCharacterMovementComponent& Movement)
+{
+	bCorridorClear = false;
+}
+
+void FLedgeGrabMovementMode::Phys(UCustomCharacterMovementComponent& Movement, float DeltaTime, int32 Iterations)
+{
+	if (DeltaTime < MIN_TICK_TIME)
+	{
+		return;
+	}
+
+	Movement.ApplyCustomVelocity(DeltaTime, Movement.GetCurrentAcceleration());
+	Movement.MoveAlongCustomVelocity(DeltaTime, Iterations, bCorridorClear);
+}
+
+void FLedgeGrabMovementMode::SaveMove(const UCustomCharacterMovementComponent& Movement, FCustomMovementModeMoveData& OutMoveData) const
+{
+	OutMoveData.Flags = bCorridorClear ? 1 : 0;
+}
+
+void FLedgeGrabMovementMode::PrepMove(UCustomCharacterMovementComponent& Movement, const FCustomMovementModeMoveData& MoveData)
+{
+	bCorridorClear = (MoveData.Flags & 1) != 0;
+}
+#pragma endregion
+
+/**
+ * --------------------
+ * - Slide
+ * --------------------
+ */
+#pragma region SLIDE
+void FSlideMovementMode::OnEnter(UCustomCharacterMovementComponent& Movement)
+{
+	SlideTime = 0.0f;
+
+	// Slides always run crouched and start with a push in the direction of travel
+	Movement.bWantsToCrouch = true;
+	Movement.Velocity += Movement.Velocity.GetSafeNormal2D() * Movement.SlideEnterImpulse;
+}
+
+void FSlideMovementMode::Phys(UCustomCharacterMovementComponent& Movement, float DeltaTime, int32 Iterations)
+{
+	if (DeltaTime < MIN_TICK_TIME)
+	{
+		return;
+	}
+
+	// Sliding off a ledge or onto a slope too steep to walk on falls like walking would
+	if (!Movement.UpdateCustomFloor())
+	{
+		Movement.SetMovementMode(MOVE_Falling);
+		Movement.StartNewPhysics(DeltaTime, Iterations);
+		return;
+	}
+
+	SlideTime += DeltaTime;
+	const FVector FloorNormal = Movement.CurrentFloor.HitResult.ImpactNormal;
+	FVector NewVelocity = Movement.Velocity;
+
+	// Gravity along the floor
+	const FVector Gravity = Movement.GetGravityDirection() * FMath::Abs(Movement.GetGravityZ()) * Movement.SlideGravityScale;
+	NewVelocity += FVector::VectorPlaneProject(Gravity, FloorNormal) * DeltaTime;
+
+	// Input only steers sideways, it cannot speed the slide up or brake it
+	const FVector SlideDirection = NewVelocity.GetSafeNormal();
+	const FVector Steering = FVector::VectorPlaneProject(Movement.GetCurrentAcceleration(), SlideDirection);
+	NewVelocity += Steering * Movement.SlideSteeringScale * DeltaTime;
+
+	// Friction
+	const float Friction = Movement.SlideFrictionCurve ? Movement.SlideFrictionCurve->GetFloatValue(SlideTime) : Movement.SlideFriction;
+	NewVelocity *= FMath::Max(1.0f - Friction * DeltaTime, 0.0f);
+	NewVelocity = FVector::VectorPlaneProject(NewVelocity, FloorNormal).GetClampedToMaxSize(Movement.SlideMaxSpeed);
+
+	Movement.ApplyCustomVelocity(DeltaTime, NewVelocity);
+	Movement.MoveAlongCustomVelocity(DeltaTime, Iterations, false);
+
+	// Out of momentum, the next move walks with whatever speed is left
+	if (Movement.Velocity.SizeSquared() < FMath::Square(Movement.SlideExitSpeed))
+	{
+		Movement.SetMovementMode(MOVE_Walking);
+	}
+}
+
+void FSlideMovementMode::SaveMove(const UCustomCharacterMovementComponent& Movement, FCustomMovementModeMoveData& OutMoveData) const
+{
+	OutMoveData.Scalar = SlideTime;
+}
+
+void FSlideMovementMode::PrepMove(UCustomCharacterMovementComponent& Movement, const FCustomMovementModeMoveData& MoveData)
+{
+	SlideTime = MoveData.Scalar;
+}
+#pragma endregion
\ No newline at end of file
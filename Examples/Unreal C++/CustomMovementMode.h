@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UCustomCharacterMovementComponent;
+
+/**
+ * Mode specific state a custom movement mode saves with each client move so replays after a correction start from it.
+ * What the fields mean is up to the mode, modes that need nothing leave them untouched.
+ */
+struct FCustomMovementModeMoveData
+{
+	FVector Vector = FVector::ZeroVector;
+	float Scalar = 0.0f;
+	uint8 Flags = 0;
+};
+
+/**
+ * A custom movement mode registered with UCustomCharacterMovementComponent under a CustomMovementMode value.
+ * Each mode owns its physics step and the prediction data it saves with client moves, that data stays on the client.
+ */
+class HORDESHOOTER_API FCustomMovementMode
+{
+public:
+	virtual ~FCustomMovementMode() = default;
+
+	virtual void OnEnter(UCustomCharacterMovementComponent& Movement) {}
+	virtual void OnExit(UCustomCharacterMovementComponent& Movement) {}
+	virtual void Phys(UCustomCharacterMovementComponent& Movement, float DeltaTime, int32 Iterations) = 0;
+
+	// Prediction
+	virtual void SaveMove(const UCustomCharacterMovementComponent& Movement, FCustomMovementModeMoveData& OutMoveData) const {}
+	virtual void PrepMove(UCustomCharacterMovementComponent& Movement, const FCustomMovementModeMoveData& MoveData) {}
+	virtual bool CanCombineMoves(const FCustomMovementModeMoveData& MoveData, const FCustomMovementModeMoveData& NewMoveData) const { return true; }
+};
+
+/**
+ * Curve driven ledge grab movement. The owner feeds the movement for each frame in through Acceleration.
+ */
+class HORDESHOOTER_API FLedgeGrabMovementMode : public FCustomMovementMode
+{
+public:
+	virtual void OnExit(UCustomCharacterMovementComponent& Movement) override;
+	virtual void Phys(UCustomCharacterMovementComponent& Movement, float DeltaTime, int32 Iterations) override;
+
+	// The corridor flag is saved for replays only, the server validates its own ledge grabs
+	virtual void SaveMove(const UCustomCharacterMovementComponent& Movement, FCustomMovementModeMoveData& OutMoveData) const override;
+	virtual void PrepMove(UCustomCharacterMovementComponent& Movement, const FCustomMovementModeMoveData& MoveData) override;
+
+	// Set once the ledge grab path has been validated clear so it can move without sweeping
+	bool bCorridorClear = false;
+};
+
+/**
+ * Momentum based slide. Gravity pulls along the floor, friction follows the slide's age
+ * and the slide hands over to walking once it drops below the exit speed.
+ */
+class HORDESHOOTER_API FSlideMovementMode : public FCustomMovementMode
+{
+public:
+	virtual void OnEnter(UCustomCharacterMovementComponent& Movement) override;
+	virtual void Phys(UCustomCharacterMovementComponent& Movement, float DeltaTime, int32 Iterations) override;
+
+	// Friction depends on the slide's age, so replayed moves start from the age they were made at
+	virtual void SaveMove(const UCustomCharacterMovementComponent& Movement, FCustomMovementModeMoveData& OutMoveData) const override;
+	virtual void PrepMove(UCustomCharacterMovementComponent& Movement, const FCustomMovementModeMoveData& MoveData) override;
+
+	float SlideTime = 0.0f;
+};
@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Base/LagCompensationSubsystem.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+
+void ULagCompensationSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// Ticks after every actor, so this records where everything ended up this frame
+	const double Now = GetWorld()->GetTimeSeconds();
+	for (int32 i = TrackedComponents.Num() - 1; i >= 0; i--)
+	{
+		FTrackedComponent& Tracked = TrackedComponents[i];
+		if (const UPrimitiveComponent* Component = Tracked.Component.Get())
+			Tracked.History.Record(Now, Component->GetComponentTransform());
+		else
+			TrackedComponents.RemoveAtSwap(i, 1, EAllowShrinking::No);
+	}
+}
+
+TStatId ULagCompensationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULagCompensationSubsystem, STATGROUP_Tickables);
+}
+
+void ULagCompensationSubsystem::Register(UPrimitiveComponent* Component)
+{
+	// Clients never rewind
+	if (!Component || GetWorld()->GetNetMode() == NM_Client)
+		return;
+
+	if (!TrackedComponents.ContainsByPredicate([Component](const FTrackedComponent& Tracked) { return Tracked.Component == Component; }))
+	{
+		// 0.5s of history at 120Hz
+		TrackedComponents.Add({ Component, FTransformHistory(FMath::CeilToInt(MaxRewindTime * 120.0f)) });
+	}
+}
+
+void ULagCompensationSubsystem::Unregister(UPrimitiveComponent* Component)
+{
+	TrackedComponents.RemoveAllSwap([Component](const FTrackedComponent& Tracked) { return Tracked.Component == Component; }, EAllowShrinking::No);
+}
+
+float ULagCompensationSubsystem::GetViewRewindTime(float RoundTripTime, float InterpolationDelay)
+{
+	return FMath::Clamp(RoundTripTime * 0.5f + InterpolationDelay, 0.0f, MaxRewindTime);
+}
+
+bool ULagCompensationSubsystem::SampleTransform(const UPrimitiveComponent* Component, double Time, FTransform& OutTransform) const
+{
+	const FTrackedComponent* Tracked = TrackedComponents.FindByPredicate([Component](const FTrackedComponent& Tracked) { return Tracked.Component == Component; });
+	return Tracked && Tracked->History.Sample(Time, OutTransform);
+}
+
+FLagCompensationScope::FLagCompensationScope(const ULagCompensationSubsystem* Subsystem, double Time, const FVector& Location, float Radius, const AActor* IgnoreActor)
+{
+	if (!Subsystem)
+		return;
+
+	const float RadiusSquared = FMath::Square(Radius);
+	for (const ULagCompensationSubsystem::FTrackedComponent& Tracked : Subsystem->TrackedComponents)
+	{
+		if (RewoundComponents.Num() == MaxRewoundComponents)
+			break;
+
+		UPrimitiveComponent* Component = Tracked.Component.Get();
+		if (!Component || Component->GetOwner() == IgnoreActor)
+			continue;
+
+		FBodyInstance* BodyInstance = Component->GetBodyInstance();
+		FTransform PastTransform;
+		if (!BodyInstance || !Tracked.History.Sample(Time, PastTransform) || FVector::DistSquared(PastTransform.GetLocation(), Location) > RadiusSquared)
+			continue;
+
+		BodyInstance->SetBodyTransform(PastTransform, ETeleportType::TeleportPhysics);
+		RewoundComponents.Add(Component);
+	}
+}
+
+FLagCompensationScope::~FLagCompensationScope()
+{
+	// The components never moved, put their bodies back where they are
+	for (UPrimitiveComponent* Component : RewoundComponents)
+	{
+		if (FBodyInstance* BodyInstance = Component->GetBodyInstance())
+			BodyInstance->SetBodyTransform(Component->GetComponentTransform(), ETeleportType::TeleportPhysics);
+	}
+}
+
+void ULagCompensatedComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+		LagCompensation->Register(Cast<UPrimitiveComponent>(GetOwner()->GetRootComponent()));
+}
+
+void ULagCompensatedComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+		LagCompensation->Unregister(Cast<UPrimitiveComponent>(GetOwner()->GetRootComponent()));
+
+	Super::EndPlay(EndPlayReason);
+}
\ No newline at end of file
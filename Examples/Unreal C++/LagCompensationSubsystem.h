@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Components/ActorComponent.h"
+#include "Base/TransformHistory.h"
+#include "LagCompensationSubsystem.generated.h"
+
+class UPrimitiveComponent;
+
+/**
+ * Server side transform history of the things that move, pawns and anything with a ULagCompensatedComponent,
+ * so checks made on behalf of a client can see the world as it was when that client acted. See FLagCompensationScope.
+ */
+UCLASS()
+class HORDESHOOTER_API ULagCompensationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void Register(UPrimitiveComponent* Component);
+	void Unregister(UPrimitiveComponent* Component);
+
+	bool SampleTransform(const UPrimitiveComponent* Component, double Time, FTransform& OutTransform) const;
+
+	// How far back a client can be rewound, checks for older times use the oldest sample
+	static constexpr float MaxRewindTime = 0.5f;
+
+	// How far behind the server a client saw other things move: half its round trip plus how long it delays them to smooth their movement
+	static float GetViewRewindTime(float RoundTripTime, float InterpolationDelay);
+
+private:
+	friend struct FLagCompensationScope;
+
+	struct FTrackedComponent
+	{
+		TWeakObjectPtr<UPrimitiveComponent> Component;
+		FTransformHistory History;
+	};
+
+	TArray<FTrackedComponent> TrackedComponents;
+};
+
+/**
+ * Moves the collision of tracked components near Location back to where it was at Time, and back again when the scope ends.
+ * Only the physics bodies move, so scene queries see the past without components moving or overlap events firing.
+ */
+struct HORDESHOOTER_API FLagCompensationScope
+{
+	FLagCompensationScope(const ULagCompensationSubsystem* Subsystem, double Time, const FVector& Location, float Radius, const AActor* IgnoreActor);
+	~FLagCompensationScope();
+
+	// Keeps the cost of a rewind bounded in crowded areas, the nearest components are not preferred
+	static constexpr int32 MaxRewoundComponents = 16;
+
+private:
+	TArray<UPrimitiveComponent*, TInlineAllocator<MaxRewoundComponents>> RewoundComponents;
+};
+
+// Tracks the owner's root collision for lag compensation, for movers and other geometry clients can interact with
+UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
+class HORDESHOOTER_API ULagCompensatedComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+};
@@ -0,0 +1,37 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Base/LagCompensationSubsystem.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLagCompensationViewRewindTest, "HordeShooter.LagCompensation.ViewRewind", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FLagCompensationViewRewindTest::RunTest(const FString& Parameters)
+{
+	// 100ms round trip and the default 100ms smoothing, the client saw others 150ms in the past
+	const float RewindTime = ULagCompensationSubsystem::GetViewRewindTime(0.1f, 0.1f);
+	TestTrue(TEXT("Simulated latency rewinds"), RewindTime > 0.0f);
+	TestEqual(TEXT("Rewind is half the round trip plus the interpolation delay"), RewindTime, 0.15f, 0.0001f);
+	TestEqual(TEXT("No latency and no smoothing rewinds nothing"), ULagCompensationSubsystem::GetViewRewindTime(0.0f, 0.0f), 0.0f);
+	TestEqual(TEXT("Rewind is clamped to the history length"), ULagCompensationSubsystem::GetViewRewindTime(2.0f, 0.1f), ULagCompensationSubsystem::MaxRewindTime);
+
+	// A mover recorded at 120Hz moving 1m per second, sampled where the client saw it
+	FTransformHistory History(FMath::CeilToInt(ULagCompensationSubsystem::MaxRewindTime * 120.0f));
+	const double Now = 10.0;
+	for (int32 i = 60; i >= 0; i--)
+	{
+		const double Time = Now - i / 120.0;
+		History.Record(Time, FTransform(FVector(Time * 100.0, 0.0, 0.0)));
+	}
+
+	FTransform Rewound;
+	TestTrue(TEXT("History has samples"), History.Sample(Now - RewindTime, Rewound));
+	TestEqual(TEXT("Mover is rewound to where the client saw it"), Rewound.GetLocation().X, (Now - RewindTime) * 100.0, 0.01);
+	TestTrue(TEXT("Mover is not checked at its present location"), Rewound.GetLocation().X < Now * 100.0 - 1.0);
+
+	return true;
+}
+
+#endif
\ No newline at end of file
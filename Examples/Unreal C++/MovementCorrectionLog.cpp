@@ -0,0 +1,103 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Base/MovementCorrectionLog.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMovementCorrectionLog, Log, All);
+
+FMovementCorrectionLog& FMovementCorrectionLog::Get()
+{
+	static FMovementCorrectionLog Instance;
+	return Instance;
+}
+
+void FMovementCorrectionLog::Open(const FString& MapName)
+{
+	check(IsInGameThread());
+	Close();
+
+	// Servers and clients often share a machine, the process id keeps their files apart
+	const FString Directory = FPaths::ProjectSavedDir() / TEXT("Telemetry");
+	const FString Path = Directory / FString::Printf(TEXT("Corrections_%s_%s_%u.bin"), *MapName, *FDateTime::Now().ToString(), FPlatformProcess::GetCurrentProcessId());
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*Directory);
+	FileHandle.Reset(PlatformFile.OpenWrite(*Path));
+	if (!FileHandle)
+	{
+		UE_LOG(LogMovementCorrectionLog, Error, TEXT("Failed to open %s"), *Path);
+		return;
+	}
+
+	// Header: magic, version, record size, map name length and the map name in UTF-8
+	const FTCHARToUTF8 MapNameUtf8(*MapName);
+	const uint32 Header[] = { Magic, Version, sizeof(FMovementCorrectionRecord), (uint32)MapNameUtf8.Length() };
+	FileHandle->Write((const uint8*)Header, sizeof(Header));
+	FileHandle->Write((const uint8*)MapNameUtf8.Get(), MapNameUtf8.Length());
+
+	if (!Queue)
+		Queue = MakeUnique<TCircularQueue<FMovementCorrectionRecord>>(Capacity);
+	WriteBuffer.Reserve(Capacity);
+	NumDropped = 0;
+	TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FMovementCorrectionLog::Tick), 1.0f);
+	UE_LOG(LogMovementCorrectionLog, Display, TEXT("Logging movement corrections to %s"), *Path);
+}
+
+void FMovementCorrectionLog::Close()
+{
+	check(IsInGameThread());
+	if (!FileHandle)
+		return;
+
+	FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+	FlushTask.Wait();
+	WriteQueued();
+	FileHandle.Reset();
+
+	if (NumDropped > 0)
+		UE_LOG(LogMovementCorrectionLog, Warning, TEXT("Dropped %d movement correction records, the buffer was full"), NumDropped);
+}
+
+void FMovementCorrectionLog::Push(const FMovementCorrectionRecord& Record)
+{
+	check(IsInGameThread());
+	if (!FileHandle)
+		return;
+
+	if (!Queue->Enqueue(Record))
+		NumDropped++;
+
+	// Bursts of corrections flush early rather than waiting for the ticker
+	if (Queue->Count() >= Capacity / 2)
+		Flush();
+}
+
+bool FMovementCorrectionLog::Tick(float DeltaTime)
+{
+	Flush();
+	return true;
+}
+
+void FMovementCorrectionLog::Flush()
+{
+	// The queue has a single consumer, a flush still writing picks up anything pushed since it started
+	if (!FlushTask.IsCompleted() || Queue->IsEmpty())
+		return;
+
+	FlushTask = UE::Tasks::Launch(UE_SOURCE_LOCATION, [this]() { WriteQueued(); });
+}
+
+void FMovementCorrectionLog::WriteQueued()
+{
+	FMovementCorrectionRecord Record;
+	while (Queue->Dequeue(Record))
+		WriteBuffer.Add(Record);
+
+	if (!WriteBuffer.IsEmpty())
+	{
+		FileHandle->Write((const uint8*)WriteBuffer.GetData(), WriteBuffer.Num() * sizeof(FMovementCorrectionRecord));
+		FileHandle->Flush();
+		WriteBuffer.Reset();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/CircularQueue.h"
+#include "Containers/Ticker.h"
+#include "Tasks/Task.h"
+
+class IFileHandle;
+
+enum class EMovementCorrectionRecordType : uint8
+{
+	// The server found a client's move too far off and corrected it
+	Server,
+	// The owning client received a correction
+	Client,
+	// The server's copy of a player left a locomotion state, Duration holds the seconds spent in it
+	StateTime,
+};
+
+/**
+ * One entry of the movement correction log, written to disk as is.
+ * The server and client records of the same correction share PlayerId and ClientTimeStamp.
+ */
+struct FMovementCorrectionRecord
+{
+	// World time on the recording side
+	float Time = 0.0f;
+	float ClientTimeStamp = 0.0f;
+	// Seconds spent in LocomotionState, StateTime records only
+	float Duration = 0.0f;
+	// Where the server has the player
+	FVector3f Location = FVector3f::ZeroVector;
+	// Client location minus server location
+	FVector3f LocationError = FVector3f::ZeroVector;
+	// Speed scale the movement component simulated with, the server's product of move speed modifiers
+	float SpeedModifier = 1.0f;
+	int32 PlayerId = INDEX_NONE;
+	// One bit per EPlayerBlocker with any blocker active
+	uint16 BlockerMask = 0;
+	EMovementCorrectionRecordType Type = EMovementCorrectionRecordType::Server;
+	uint8 LocomotionState = 0;
+	uint8 MovementMode = 0;
+	uint8 CustomMovementMode = 0;
+	uint8 Padding[2] = {};
+};
+
+static_assert(sizeof(FMovementCorrectionRecord) == 52, "Update the version and Scripts/AggregateCorrections.py when the record layout changes");
+
+/**
+ * Binary log of movement corrections, one file per map under Saved/Telemetry, read by Scripts/AggregateCorrections.py.
+ * The game thread pushes records into a lock-free ring buffer that a background task drains to disk,
+ * so recording never waits on the file. Enabled with -CorrectionLog.
+ */
+class HORDESHOOTER_API FMovementCorrectionLog
+{
+public:
+	// Game thread only
+	static FMovementCorrectionLog& Get();
+
+	// Starts a new file for the map, closing the previous one
+	void Open(const FString& MapName);
+	// Writes out everything still queued
+	void Close();
+	bool IsOpen() const { return FileHandle.IsValid(); }
+
+	// Drops the record if the buffer is full, which only happens if the disk falls far behind
+	void Push(const FMovementCorrectionRecord& Record);
+
+	// "HSMC" in little endian byte order
+	static constexpr uint32 Magic = 0x434D5348;
+	static constexpr uint32 Version = 3;
+	static constexpr uint32 Capacity = 8192;
+
+private:
+	FMovementCorrectionLog() = default;
+
+	bool Tick(float DeltaTime);
+	void Flush();
+	// Writer side of the queue, only ever run by one task at a time
+	void WriteQueued();
+
+private:
+	// Allocated by the first Open, so processes that never log don't pay for the buffer
+	TUniquePtr<TCircularQueue<FMovementCorrectionRecord>> Queue;
+	TUniquePtr<IFileHandle> FileHandle;
+	UE::Tasks::FTask FlushTask;
+	FTSTicker::FDelegateHandle TickerHandle;
+	TArray<FMovementCorrectionRecord> WriteBuffer;
+	int32 NumDropped = 0;
+};
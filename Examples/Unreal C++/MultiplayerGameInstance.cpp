@@ -7,6 +7,11 @@
 #include "OnlineSessionSettings.h"
 #include <AssetRegistry/AssetRegistryModule.h>
 #include "Engine/Console.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/Pawn.h"
+#include "Player/PlayerPawnPool.h"
+#include "Base/MovementCorrectionLog.h"
 
 DEFINE_LOG_CATEGORY(LogMultiplayerGameInstance);
 
@@ -24,6 +29,22 @@ void UMultiplayerGameInstance::Init()
 {
 	Super::Init();
 
+	// Packed dedicated server instances need their port assigned before the server starts listening
+	if (IsDedicatedServerInstance() && FParse::Param(FCommandLine::Get(), TEXT("PackedServer")))
+	{
+		ServerInstanceIndex = 0;
+		FParse::Value(FCommandLine::Get(), TEXT("ServerInstance="), ServerInstanceIndex);
+		ConfigurePackedServerInstance();
+	}
+
+	// Input record and replay (-RecordInput=Name, -ReplayInput=Name)
+	FString InputRecordingName;
+	if (FParse::Value(FCommandLine::Get(), TEXT("RecordInput="), InputRecordingName))
+		StartInputRecording(InputRecordingName);
+	if (FParse::Value(FCommandLine::Get(), TEXT("ReplayInput="), InputRecordingName))
+		InputPlayback.Open(GetInputRecordingPath(InputRecordingName));
+	FCoreUObjectDelegates::PostLoadMapWithWorld.AddUObject(this, &UMultiplayerGameInstance::OnPostLoadMap);
+
 	// Get the online subsystem
 	Subsystem = IOnlineSubsystem::Get();
 	if (!Subsystem)
@@ -45,6 +66,22 @@ void UMultiplayerGameInstance::Init()
 	SessionInterface->OnDestroySessionCompleteDelegates.AddUObject(this, &UMultiplayerGameInstance::OnDestroySessionComplete);
 	SessionInterface->OnJoinSessionCompleteDelegates.AddUObject(this, &UMultiplayerGameInstance::OnJoinSessionComplete);
 	SessionInterface->OnSessionUserInviteAcceptedDelegates.AddUObject(this, &UMultiplayerGameInstance::OnInviteAccepted);
+
+	// Packed instances are started from the command line rather than through Host, so advertise them here
+	if (IsPackedServerInstance())
+		CreateSession();
+}
+
+void UMultiplayerGameInstance::Shutdown()
+{
+	FCoreUObjectDelegates::PostLoadMapWithWorld.RemoveAll(this);
+	if (PawnCostPhase != EPawnCostPhase::Idle)
+		FinishPawnCostMeasurement();
+	InputRecorder.Close();
+	InputPlayback.Close();
+	FMovementCorrectionLog::Get().Close();
+
+	Super::Shutdown();
 }
 
 void UMultiplayerGameInstance::Host(const FString& MapPath)
@@ -111,6 +148,37 @@ void UMultiplayerGameInstance::ShutdownSession()
 	DestroySession();
 }
 
+void UMultiplayerGameInstance::LogMemoryStats()
+{
+	const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+	UE_LOG(LogMultiplayerGameInstance, Display, TEXT("Instance %d | Used physical: %.1f MB | Peak physical: %.1f MB | Used virtual: %.1f MB"),
+		ServerInstanceIndex,
+		MemoryStats.UsedPhysical / (1024.0 * 1024.0),
+		MemoryStats.PeakUsedPhysical / (1024.0 * 1024.0),
+		MemoryStats.UsedVirtual / (1024.0 * 1024.0));
+}
+
+void UMultiplayerGameInstance::ConfigurePackedServerInstance()
+{
+	// Give each instance on the host its own port unless one was passed explicitly
+	int32 ExplicitPort = 0;
+	if (!FParse::Value(FCommandLine::Get(), TEXT("Port="), ExplicitPort))
+	{
+		FParse::Value(FCommandLine::Get(), TEXT("PackedServerBasePort="), PackedServerBasePort);
+		FURL::UrlConfig.DefaultPort = PackedServerBasePort + ServerInstanceIndex;
+	}
+
+	// Instances only share cooked packages when they read them from the same staged IoStore containers.
+	// Those are opened read-only, so the OS page cache backing them is shared between every instance on the host.
+	if (!FPlatformProperties::RequiresCookedData())
+	{
+		UE_LOG(LogMultiplayerGameInstance, Warning, TEXT("Packed server instance %d is running uncooked, content will not be shared between instances"), ServerInstanceIndex);
+	}
+
+	UE_LOG(LogMultiplayerGameInstance, Display, TEXT("Packed server instance %d listening on port %d"), ServerInstanceIndex, FURL::UrlConfig.DefaultPort);
+	LogMemoryStats();
+}
+
 void UMultiplayerGameInstance::CreateSession()
 {
 	if (!SessionInterface.IsValid())
@@ -118,14 +186,18 @@ void UMultiplayerGameInstance::CreateSession()
 	
 	UE_LOG(LogMultiplayerGameInstance, Display, TEXT("Creating session"));
 
+	// Dedicated servers have no hosting player, so presence and lobbies do not apply
+	const bool bIsDedicated = IsDedicatedServerInstance();
+
 	FOnlineSessionSettings SessionSettings;
 	SessionSettings.bIsLANMatch = false;
+	SessionSettings.bIsDedicated = bIsDedicated;
 	SessionSettings.NumPublicConnections = 4;
-	SessionSettings.bUsesPresence = true;
+	SessionSettings.bUsesPresence = !bIsDedicated;
 	SessionSettings.bShouldAdvertise = true;
 	SessionSettings.bAllowJoinInProgress = true;
-	SessionSettings.bAllowJoinViaPresenceFriendsOnly = true;
-	SessionSettings.bUseLobbiesIfAvailable = true;
+	SessionSettings.bAllowJoinViaPresenceFriendsOnly = !bIsDedicated;
+	SessionSettings.bUseLobbiesIfAvailable = !bIsDedicated;
 	SessionInterface->CreateSession(0, SESSION_NAME, SessionSettings);
 
 	OnCreateSessionCompleteBlueprint(SESSION_NAME);
@@ -233,3 +305,206 @@ void UMultiplayerGameInstance::OnInviteAccepted(const bool bWasSuccessful, const
 
 	SessionInterface->JoinSession(0, SESSION_NAME, InviteResult);
 }
+
+
+void UMultiplayerGameInstance::StartInputRecording(const FString& Name)
+{
+	if (Name.IsEmpty())
+	{
+		UE_LOG(LogMultiplayerGameInstance, Error, TEXT("No input recording name"));
+		return;
+	}
+
+	if (!InputRecorder.Open(GetInputRecordingPath(Name)))
+		return;
+
+	// Recording mid-session starts on the current map and pawn
+	if (UWorld* World = GetWorld())
+		InputRecorder.RecordEvent(EPlayerInputSessionEvent::MapLoaded, World->GetMapName());
+	if (APlayerController* PlayerController = GetFirstLocalPlayerController())
+	{
+		if (APawn* Pawn = PlayerController->GetPawn())
+			InputRecorder.RecordEvent(EPlayerInputSessionEvent::Possessed, Pawn->GetName());
+	}
+}
+
+void UMultiplayerGameInstance::StopInputRecording()
+{
+	InputRecorder.Close();
+}
+
+FString UMultiplayerGameInstance::GetInputRecordingPath(const FString& Name)
+{
+	FString Path = FPaths::IsRelative(Name) ? FPaths::ProjectSavedDir() / TEXT("InputRecordings") / Name : Name;
+	if (FPaths::GetExtension(Path).IsEmpty())
+		Path += TEXT(".hsinput");
+	return Path;
+}
+
+void UMultiplayerGameInstance::OnPostLoadMap(UWorld* LoadedWorld)
+{
+	if (LoadedWorld && InputRecorder.IsRecording())
+		InputRecorder.RecordEvent(EPlayerInputSessionEvent::MapLoaded, LoadedWorld->GetMapName());
+
+	// Movement correction telemetry (-CorrectionLog), a file per map
+	if (LoadedWorld && FParse::Param(FCommandLine::Get(), TEXT("CorrectionLog")))
+		FMovementCorrectionLog::Get().Open(LoadedWorld->GetMapName());
+
+	// Headless pawn cost runs (-MeasurePawnCost=N) start once the map is up
+	int32 NumPawns = 0;
+	if (LoadedWorld && FParse::Value(FCommandLine::Get(), TEXT("MeasurePawnCost="), NumPawns))
+		MeasurePawnCost(NumPawns);
+}
+
+void UMultiplayerGameInstance::MeasurePawnCost(int32 NumPawns)
+{
+	UWorld* World = GetWorld();
+	if (!World || !World->GetAuthGameMode() || NumPawns <= 0)
+	{
+		UE_LOG(LogMultiplayerGameInstance, Error, TEXT("MeasurePawnCost needs a positive pawn count and must run on the server"));
+		return;
+	}
+	if (PawnCostPhase != EPawnCostPhase::Idle)
+	{
+		UE_LOG(LogMultiplayerGameInstance, Warning, TEXT("MeasurePawnCost is already running"));
+		return;
+	}
+
+	UE_LOG(LogMultiplayerGameInstance, Display, TEXT("Measuring the cost of %d pawns..."), NumPawns);
+	PawnCostNumPawns = NumPawns;
+	PawnCostPhase = EPawnCostPhase::Baseline;
+	PawnCostFrames = 0;
+	PawnCostActorTickSeconds = 0.0;
+	FWorldDelegates::OnWorldPreActorTick.AddUObject(this, &UMultiplayerGameInstance::OnWorldPreActorTick);
+	FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UMultiplayerGameInstance::OnWorldPostActorTick);
+	PawnCostTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UMultiplayerGameInstance::TickPawnCostMeasurement));
+}
+
+void UMultiplayerGameInstance::BenchmarkPawnSpawns(int32 NumSpawns)
+{
+	UWorld* World = GetWorld();
+	const AGameModeBase* GameMode = World ? World->GetAuthGameMode() : nullptr;
+	UPlayerPawnPoolSubsystem* PawnPool = World ? World->GetSubsystem<UPlayerPawnPoolSubsystem>() : nullptr;
+	if (!GameMode || !PawnPool || !GameMode->DefaultPawnClass || !GameMode->DefaultPawnClass->IsChildOf<APlayerBase>())
+	{
+		UE_LOG(LogMultiplayerGameInstance, Error, TEXT("BenchmarkPawnSpawns must run on the server with an APlayerBase default pawn"));
+		return;
+	}
+
+	PawnPool->BenchmarkSpawns(*GameMode->DefaultPawnClass, NumSpawns);
+}
+
+bool UMultiplayerGameInstance::TickPawnCostMeasurement(float DeltaTime)
+{
+	constexpr int32 SampleFrames = 300;
+	constexpr int32 SettleFrames = 60;
+
+	PawnCostFrames++;
+	switch (PawnCostPhase)
+	{
+	case EPawnCostPhase::Baseline:
+		if (PawnCostFrames < SampleFrames)
+			return true;
+		PawnCostBaselineTickSeconds = PawnCostActorTickSeconds / PawnCostFrames;
+		PawnCostBaselineUsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+		SpawnPawnCostPawns();
+		PawnCostPhase = EPawnCostPhase::Settle;
+		break;
+
+	case EPawnCostPhase::Settle:
+		// Memory is read after the pawns have ticked a while, so lazily allocated state is counted too
+		if (PawnCostFrames < SettleFrames)
+			return true;
+		PawnCostUsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+		PawnCostPhase = EPawnCostPhase::Measure;
+		break;
+
+	case EPawnCostPhase::Measure:
+	{
+		if (PawnCostFrames < SampleFrames)
+			return true;
+
+		const double TickSeconds = PawnCostActorTickSeconds / PawnCostFrames;
+		const double MemoryPerPawn = ((double)PawnCostUsedPhysical - (double)PawnCostBaselineUsedPhysical) / FMath::Max(PawnCostPawns.Num(), 1);
+		UE_LOG(LogMultiplayerGameInstance, Display, TEXT("PawnCostReport Pawns=%d Spawned=%d | Memory: %.1f KB per pawn | Actor tick: %.3f ms baseline, %.3f ms with pawns, %.2f us per pawn"),
+			PawnCostNumPawns,
+			PawnCostPawns.Num(),
+			MemoryPerPawn / 1024.0,
+			PawnCostBaselineTickSeconds * 1000.0,
+			TickSeconds * 1000.0,
+			(TickSeconds - PawnCostBaselineTickSeconds) * 1000000.0 / FMath::Max(PawnCostPawns.Num(), 1));
+
+		FinishPawnCostMeasurement();
+		return false;
+	}
+
+	default:
+		return false;
+	}
+
+	PawnCostFrames = 0;
+	PawnCostActorTickSeconds = 0.0;
+	return true;
+}
+
+void UMultiplayerGameInstance::OnWorldPreActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if (World == GetWorld())
+		PawnCostActorTickStart = FPlatformTime::Seconds();
+}
+
+void UMultiplayerGameInstance::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if (World == GetWorld() && PawnCostActorTickStart > 0.0)
+		PawnCostActorTickSeconds += FPlatformTime::Seconds() - PawnCostActorTickStart;
+}
+
+void UMultiplayerGameInstance::SpawnPawnCostPawns()
+{
+	UWorld* World = GetWorld();
+	AGameModeBase* GameMode = World ? World->GetAuthGameMode() : nullptr;
+	if (!GameMode || !GameMode->DefaultPawnClass)
+		return;
+
+	// A grid around the first player start, spaced so the capsules do not overlap
+	const AActor* PlayerStart = GameMode->FindPlayerStart(nullptr);
+	const FVector Origin = PlayerStart ? PlayerStart->GetActorLocation() : FVector::ZeroVector;
+	const int32 GridSize = FMath::CeilToInt(FMath::Sqrt((float)PawnCostNumPawns));
+	constexpr float Spacing = 150.0f;
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	PawnCostPawns.Reserve(PawnCostNumPawns);
+	for (int32 i = 0; i < PawnCostNumPawns; i++)
+	{
+		const FVector Offset((i % GridSize - GridSize / 2) * Spacing, (i / GridSize - GridSize / 2) * Spacing, 0.0f);
+		APawn* Pawn = World->SpawnActor<APawn>(GameMode->DefaultPawnClass, Origin + Offset, FRotator::ZeroRotator, SpawnParams);
+		if (!Pawn)
+			continue;
+
+		// Unpossessed characters skip movement, a controller makes them cost what a connected player's pawn would
+		if (!Pawn->GetController())
+			Pawn->SpawnDefaultController();
+		PawnCostPawns.Add(Pawn);
+	}
+}
+
+void UMultiplayerGameInstance::FinishPawnCostMeasurement()
+{
+	FTSTicker::GetCoreTicker().RemoveTicker(PawnCostTickerHandle);
+	FWorldDelegates::OnWorldPreActorTick.RemoveAll(this);
+	FWorldDelegates::OnWorldPostActorTick.RemoveAll(this);
+
+	for (const TWeakObjectPtr<APawn>& Pawn : PawnCostPawns)
+	{
+		if (!Pawn.IsValid())
+			continue;
+		if (AController* PawnController = Pawn->GetController())
+			PawnController->Destroy();
+		Pawn->Destroy();
+	}
+	PawnCostPawns.Reset();
+	PawnCostPhase = EPawnCostPhase::Idle;
+	PawnCostActorTickStart = 0.0;
+}
\ No newline at end of file
@@ -6,6 +6,8 @@
 #include "Engine/GameInstance.h"
 #include "OnlineSubsystem.h"
 #include "Interfaces/OnlineSessionInterface.h"
+#include "Player/PlayerInputRecording.h"
+#include "Containers/Ticker.h"
 #include "MultiplayerGameInstance.generated.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(LogMultiplayerGameInstance, Log, All);
@@ -23,6 +25,7 @@ public:
 	virtual ~UMultiplayerGameInstance();
 
 	virtual void Init() override;
+	virtual void Shutdown() override;
 
 	UFUNCTION(BlueprintImplementableEvent, DisplayName = "OnCreateSessionComplete")
 	void OnCreateSessionCompleteBlueprint(FName SessionName);
@@ -36,7 +39,34 @@ public:
 	UFUNCTION(Exec, BlueprintCallable)
 	virtual void ShutdownSession();
 
+	UFUNCTION(Exec)
+	void LogMemoryStats();
+
+	// Packed dedicated servers (-PackedServer -ServerInstance=N) run many instances of the same staged build per host
+	bool IsPackedServerInstance() const { return ServerInstanceIndex != INDEX_NONE; }
+	int32 GetServerInstanceIndex() const { return ServerInstanceIndex; }
+
+	// Input record and replay, recordings are named files under Saved/InputRecordings unless given a full path
+	UFUNCTION(Exec)
+	void StartInputRecording(const FString& Name);
+
+	UFUNCTION(Exec)
+	void StopInputRecording();
+
+	FPlayerInputRecorder* GetInputRecorder() { return InputRecorder.IsRecording() ? &InputRecorder : nullptr; }
+	FPlayerInputPlayback* GetInputPlayback() { return InputPlayback.IsPlaying() ? &InputPlayback : nullptr; }
+	static FString GetInputRecordingPath(const FString& Name);
+
+	// Spawns AI controlled default pawns on the server and logs the memory and actor tick time each one adds
+	UFUNCTION(Exec)
+	void MeasurePawnCost(int32 NumPawns = 100);
+
+	// Logs spawn latency percentiles of the default pawn class, spawned fresh and taken from the pawn pool
+	UFUNCTION(Exec)
+	void BenchmarkPawnSpawns(int32 NumSpawns = 50);
+
 private:
+	void ConfigurePackedServerInstance();
 	void CreateSession();
 	void DestroySession();
 
@@ -44,9 +74,37 @@ private:
 	void OnDestroySessionComplete(FName SessionName, bool bWasSuccessful);
 	void OnJoinSessionComplete(FName SessionName, EOnJoinSessionCompleteResult::Type Result);
 	void OnInviteAccepted(const bool bWasSuccessful, const int32 ControllerId, FUniqueNetIdPtr UserId, const FOnlineSessionSearchResult& InviteResult);
+	void OnPostLoadMap(UWorld* LoadedWorld);
+
+	bool TickPawnCostMeasurement(float DeltaTime);
+	void OnWorldPreActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	void SpawnPawnCostPawns();
+	void FinishPawnCostMeasurement();
 
 private:
 	const FName SESSION_NAME = TEXT("MySession");
 	IOnlineSubsystem* Subsystem;
 	IOnlineSessionPtr SessionInterface;
+
+	// Packed server instance
+	int32 ServerInstanceIndex = INDEX_NONE;
+	int32 PackedServerBasePort = 7777;
+
+	// Input record and replay
+	FPlayerInputRecorder InputRecorder;
+	FPlayerInputPlayback InputPlayback;
+
+	// Pawn cost measurement, baseline frames, then spawn and settle, then measured frames
+	enum class EPawnCostPhase : uint8 { Idle, Baseline, Settle, Measure };
+	EPawnCostPhase PawnCostPhase = EPawnCostPhase::Idle;
+	FTSTicker::FDelegateHandle PawnCostTickerHandle;
+	TArray<TWeakObjectPtr<APawn>> PawnCostPawns;
+	int32 PawnCostNumPawns = 0;
+	int32 PawnCostFrames = 0;
+	double PawnCostActorTickStart = 0.0;
+	double PawnCostActorTickSeconds = 0.0;
+	double PawnCostBaselineTickSeconds = 0.0;
+	uint64 PawnCostBaselineUsedPhysical = 0;
+	uint64 PawnCostUsedPhysical = 0;
 };
@@ -0,0 +1,339 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Base/NetAccountingSubsystem.h"
+#include "Engine/World.h"
+#include "Engine/NetDriver.h"
+#include "Engine/NetConnection.h"
+#include "Engine/Channel.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+#include "Serialization/JsonWriter.h"
+#include "HttpServerModule.h"
+#include "IHttpRouter.h"
+#include "HttpServerResponse.h"
+#include "Misc/ConfigCacheIni.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogNetAccounting, Log, All);
+
+CSV_DEFINE_CATEGORY(NetAccounting, true);
+
+static TAutoConsoleVariable<bool> CVarNetAccounting(
+	TEXT("HordeShooter.NetAccounting"),
+	false,
+	TEXT("Count RPCs and replicated property changes per function and connection. Also enabled by -NetAccounting."));
+
+static FAutoConsoleCommandWithWorldArgsAndOutputDevice CmdNetAccountingDump(
+	TEXT("HordeShooter.NetAccounting.Dump"),
+	TEXT("Prints RPC and replication counts per connection and function. Pass reset to clear them afterwards."),
+	FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		UNetAccountingSubsystem* NetAccounting = World ? World->GetSubsystem<UNetAccountingSubsystem>() : nullptr;
+		if (!NetAccounting)
+			return;
+
+		NetAccounting->Dump(Ar);
+		if (Args.Contains(TEXT("reset")))
+			NetAccounting->Reset();
+	}));
+
+namespace
+{
+	FNetAccountingCounter& FindOrAddCounter(TMap<FName, FNetAccountingCounter>& Counters, FName Name, const TCHAR* CsvPrefix)
+	{
+		FNetAccountingCounter& Counter = Counters.FindOrAdd(Name);
+		if (Counter.CsvStatName.IsNone())
+			Counter.CsvStatName = FName(FString::Printf(TEXT("%s_%s"), CsvPrefix, *Name.ToString()));
+		return Counter;
+	}
+
+	void AddToCounter(FNetAccountingCounter& Counter, int64 Bits)
+	{
+		Counter.Count++;
+		Counter.Bits += Bits;
+		Counter.FrameCount++;
+		Counter.FrameBits += Bits;
+	}
+
+	void DumpCounters(FOutputDevice& Ar, const TCHAR* Label, const TMap<FName, FNetAccountingCounter>& Counters, bool bHasBits)
+	{
+		for (const TPair<FName, FNetAccountingCounter>& Pair : Counters)
+		{
+			if (bHasBits)
+				Ar.Logf(TEXT("    %s %-32s %8lld calls %10lld bytes"), Label, *Pair.Key.ToString(), Pair.Value.Count, Pair.Value.Bits / 8);
+			else
+				Ar.Logf(TEXT("    %s %-32s %8lld"), Label, *Pair.Key.ToString(), Pair.Value.Count);
+		}
+	}
+
+	using FJsonWriter = TJsonWriter<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>;
+
+	void WriteCounters(FJsonWriter& Writer, const TCHAR* Identifier, const TMap<FName, FNetAccountingCounter>& Counters)
+	{
+		Writer.WriteObjectStart(Identifier);
+		for (const TPair<FName, FNetAccountingCounter>& Pair : Counters)
+		{
+			Writer.WriteObjectStart(Pair.Key.ToString());
+			Writer.WriteValue(TEXT("count"), Pair.Value.Count);
+			Writer.WriteValue(TEXT("bytes"), Pair.Value.Bits / 8);
+			Writer.WriteObjectEnd();
+		}
+		Writer.WriteObjectEnd();
+	}
+
+	bool IsLoopbackAddress(const FString& Address)
+	{
+		return Address == TEXT("localhost") || Address == TEXT("::1") || Address.StartsWith(TEXT("127."));
+	}
+
+	// HTTPServer reads a listener's bind address from config when it starts listening, so the port gets a loopback override.
+	// A port someone already configured is only used if it is on loopback as well.
+	bool ConfigureLoopbackListener(int32 Port)
+	{
+		const TCHAR* Section = TEXT("HTTPServer.Listeners");
+		TArray<FString> Overrides;
+		GConfig->GetArray(Section, TEXT("ListenerOverrides"), Overrides, GEngineIni);
+		for (const FString& Override : Overrides)
+		{
+			int32 OverridePort = 0;
+			if (!FParse::Value(*Override, TEXT("Port="), OverridePort) || OverridePort != Port)
+				continue;
+
+			FString BindAddress;
+			FParse::Value(*Override, TEXT("BindAddress="), BindAddress);
+			return IsLoopbackAddress(BindAddress);
+		}
+
+		Overrides.Add(FString::Printf(TEXT("(Port=%d,BindAddress=127.0.0.1)"), Port));
+		GConfig->SetArray(Section, TEXT("ListenerOverrides"), Overrides, GEngineIni);
+		return true;
+	}
+}
+
+void UNetAccountingSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	// Optional JSON endpoint for local monitoring, never reachable from the network
+	if (GetWorld()->IsGameWorld() && FParse::Value(FCommandLine::Get(), TEXT("NetAccountingHttpPort="), HttpPort) && HttpPort > 0)
+	{
+		if (!ConfigureLoopbackListener(HttpPort))
+		{
+			UE_LOG(LogNetAccounting, Warning, TEXT("Not serving net accounting on port %d, HTTPServer has it configured for a non-loopback address"), HttpPort);
+			HttpPort = 0;
+			return;
+		}
+
+		if (TSharedPtr<IHttpRouter> HttpRouter = FHttpServerModule::Get().GetHttpRouter(HttpPort, true))
+		{
+			HttpRouteHandle = HttpRouter->BindRoute(FHttpPath(TEXT("/netaccounting")), EHttpServerRequestVerbs::VERB_GET,
+				FHttpRequestHandler::CreateUObject(this, &UNetAccountingSubsystem::HandleHttpRequest));
+			FHttpServerModule::Get().StartAllListeners();
+		}
+	}
+}
+
+void UNetAccountingSubsystem::Deinitialize()
+{
+	if (HttpRouteHandle)
+	{
+		if (TSharedPtr<IHttpRouter> HttpRouter = FHttpServerModule::Get().GetHttpRouter(HttpPort))
+			HttpRouter->UnbindRoute(HttpRouteHandle);
+		HttpRouteHandle.Reset();
+	}
+
+	Super::Deinitialize();
+}
+
+void UNetAccountingSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!IsEnabled())
+		return;
+
+	SampleReliableBuffers();
+	RecordCsvStats();
+}
+
+TStatId UNetAccountingSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UNetAccountingSubsystem, STATGROUP_Tickables);
+}
+
+bool UNetAccountingSubsystem::IsEnabled()
+{
+	static const bool bCommandLine = FParse::Param(FCommandLine::Get(), TEXT("NetAccounting"));
+	return bCommandLine || CVarNetAccounting.GetValueOnGameThread();
+}
+
+void UNetAccountingSubsystem::RecordSentRpc(UNetConnection* Connection, FName FunctionName, int64 Bits)
+{
+	AddToCounter(FindOrAddCounter(FindOrAddConnection(Connection).SentRpcs, FunctionName, TEXT("SentBytes")), FMath::Max<int64>(Bits, 0));
+}
+
+void UNetAccountingSubsystem::RecordReceivedRpc(UNetConnection* Connection, FName FunctionName)
+{
+	AddToCounter(FindOrAddCounter(FindOrAddConnection(Connection).ReceivedRpcs, FunctionName, TEXT("Received")), 0);
+}
+
+void UNetAccountingSubsystem::RecordPropertyChange(FName PropertyName)
+{
+	AddToCounter(FindOrAddCounter(PropertyChanges, PropertyName, TEXT("Changed")), 0);
+}
+
+int64 UNetAccountingSubsystem::GetNumReceivedRpcs(const UNetConnection* Connection) const
+{
+	for (const FConnectionAccounting& Accounting : Connections)
+	{
+		if (Accounting.Connection != Connection)
+			continue;
+
+		int64 Count = 0;
+		for (const TPair<FName, FNetAccountingCounter>& Pair : Accounting.ReceivedRpcs)
+			Count += Pair.Value.Count;
+		return Count;
+	}
+	return 0;
+}
+
+void UNetAccountingSubsystem::Dump(FOutputDevice& Ar) const
+{
+	Ar.Logf(TEXT("Net accounting, %d connections"), Connections.Num());
+	for (const FConnectionAccounting& Accounting : Connections)
+	{
+		Ar.Logf(TEXT("  %s%s | Reliable buffer %d/%d, peak %d"), *Accounting.Name, Accounting.Connection.IsValid() ? TEXT("") : TEXT(" (closed)"),
+			Accounting.ReliableBufferUsed, RELIABLE_BUFFER, Accounting.ReliableBufferPeak);
+		DumpCounters(Ar, TEXT("Sent"), Accounting.SentRpcs, true);
+		DumpCounters(Ar, TEXT("Received"), Accounting.ReceivedRpcs, false);
+	}
+
+	Ar.Logf(TEXT("  Replicated property changes"));
+	DumpCounters(Ar, TEXT("Changed"), PropertyChanges, false);
+}
+
+FString UNetAccountingSubsystem::ToJson() const
+{
+	FString Json;
+	TSharedRef<FJsonWriter> Writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&Json);
+	Writer->WriteObjectStart();
+	Writer->WriteArrayStart(TEXT("connections"));
+	for (const FConnectionAccounting& Accounting : Connections)
+	{
+		Writer->WriteObjectStart();
+		Writer->WriteValue(TEXT("name"), Accounting.Name);
+		Writer->WriteValue(TEXT("open"), Accounting.Connection.IsValid());
+		Writer->WriteValue(TEXT("reliableBufferUsed"), Accounting.ReliableBufferUsed);
+		Writer->WriteValue(TEXT("reliableBufferPeak"), Accounting.ReliableBufferPeak);
+		Writer->WriteValue(TEXT("reliableBufferSize"), RELIABLE_BUFFER);
+		WriteCounters(*Writer, TEXT("sentRpcs"), Accounting.SentRpcs);
+		WriteCounters(*Writer, TEXT("receivedRpcs"), Accounting.ReceivedRpcs);
+		Writer->WriteObjectEnd();
+	}
+	Writer->WriteArrayEnd();
+	WriteCounters(*Writer, TEXT("propertyChanges"), PropertyChanges);
+	Writer->WriteObjectEnd();
+	Writer->Close();
+	return Json;
+}
+
+void UNetAccountingSubsystem::Reset()
+{
+	Connections.Reset();
+	PropertyChanges.Reset();
+}
+
+UNetAccountingSubsystem::FConnectionAccounting& UNetAccountingSubsystem::FindOrAddConnection(UNetConnection* Connection)
+{
+	// Only a handful of connections, a linear search beats hashing weak pointers
+	for (FConnectionAccounting& Accounting : Connections)
+	{
+		if (Accounting.Connection == Connection)
+			return Accounting;
+	}
+
+	FConnectionAccounting& Accounting = Connections.AddDefaulted_GetRef();
+	Accounting.Connection = Connection;
+	Accounting.Name = Connection ? Connection->LowLevelGetRemoteAddress(true) : TEXT("Local");
+	return Accounting;
+}
+
+void UNetAccountingSubsystem::SampleReliableBuffers()
+{
+	const UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	if (!NetDriver)
+		return;
+
+	auto Sample = [this](UNetConnection* Connection)
+	{
+		if (!Connection)
+			return;
+
+		// A channel stalls once its own reliable buffer fills, so the fullest channel is what matters
+		int32 Used = 0;
+		for (const UChannel* Channel : Connection->OpenChannels)
+		{
+			if (Channel)
+				Used = FMath::Max(Used, Channel->NumOutRec);
+		}
+
+		FConnectionAccounting& Accounting = FindOrAddConnection(Connection);
+		Accounting.ReliableBufferUsed = Used;
+		Accounting.ReliableBufferPeak = FMath::Max(Accounting.ReliableBufferPeak, Used);
+	};
+
+	Sample(NetDriver->ServerConnection);
+	for (UNetConnection* Connection : NetDriver->ClientConnections)
+		Sample(Connection);
+}
+
+void UNetAccountingSubsystem::RecordCsvStats()
+{
+	int32 ReliableBufferUsed = 0;
+	for (FConnectionAccounting& Accounting : Connections)
+	{
+		ReliableBufferUsed = FMath::Max(ReliableBufferUsed, Accounting.ReliableBufferUsed);
+
+		// Totals across connections go to the CSV, per connection numbers are in the dump and the JSON
+		for (TPair<FName, FNetAccountingCounter>& Pair : Accounting.SentRpcs)
+		{
+#if CSV_PROFILER
+			if (Pair.Value.FrameCount > 0)
+			{
+				FCsvProfiler::RecordCustomStat(Pair.Value.CsvStatName, CSV_CATEGORY_INDEX(NetAccounting), (float)Pair.Value.FrameBits / 8.0f, ECsvCustomStatOp::Accumulate);
+			}
+#endif
+			Pair.Value.FrameCount = 0;
+			Pair.Value.FrameBits = 0;
+		}
+		for (TPair<FName, FNetAccountingCounter>& Pair : Accounting.ReceivedRpcs)
+		{
+#if CSV_PROFILER
+			if (Pair.Value.FrameCount > 0)
+			{
+				FCsvProfiler::RecordCustomStat(Pair.Value.CsvStatName, CSV_CATEGORY_INDEX(NetAccounting), (float)Pair.Value.FrameCount, ECsvCustomStatOp::Accumulate);
+			}
+#endif
+			Pair.Value.FrameCount = 0;
+		}
+	}
+
+	for (TPair<FName, FNetAccountingCounter>& Pair : PropertyChanges)
+	{
+#if CSV_PROFILER
+		if (Pair.Value.FrameCount > 0)
+		{
+			FCsvProfiler::RecordCustomStat(Pair.Value.CsvStatName, CSV_CATEGORY_INDEX(NetAccounting), (float)Pair.Value.FrameCount, ECsvCustomStatOp::Accumulate);
+		}
+#endif
+		Pair.Value.FrameCount = 0;
+	}
+
+	CSV_CUSTOM_STAT(NetAccounting, ReliableBufferUsed, ReliableBufferUsed, ECsvCustomStatOp::Set);
+}
+
+bool UNetAccountingSubsystem::HandleHttpRequest(const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete)
+{
+	OnComplete(FHttpServerResponse::Create(ToJson(), TEXT("application/json")));
+	return true;
+}
\ No newline at end of file
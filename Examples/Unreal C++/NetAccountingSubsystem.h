@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "HttpRouteHandle.h"
+#include "HttpResultCallback.h"
+#include "NetAccountingSubsystem.generated.h"
+
+class UNetConnection;
+struct FHttpServerRequest;
+
+struct FNetAccountingCounter
+{
+	int64 Count = 0;
+	int64 Bits = 0;
+	// Since the last CSV sample
+	int32 FrameCount = 0;
+	int64 FrameBits = 0;
+	// Sent RPCs are recorded in bytes, received RPCs and property changes in calls
+	FName CsvStatName;
+};
+
+/**
+ * Counts RPCs and replicated property changes per function and per connection, and how full each connection's
+ * reliable buffer gets. Pawns report what they send and receive, see APlayerBase::CallRemoteFunction.
+ * Off by default, enable it with -NetAccounting or HordeShooter.NetAccounting 1.
+ * Read it with HordeShooter.NetAccounting.Dump, the NetAccounting CSV profiler category,
+ * or as JSON from http://127.0.0.1:<port>/netaccounting when started with -NetAccountingHttpPort=<port>, which only listens on loopback.
+ */
+UCLASS()
+class HORDESHOOTER_API UNetAccountingSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	static bool IsEnabled();
+
+	// Bits are what the call added to the connection's send buffer, approximate when the call also flushed a packet
+	void RecordSentRpc(UNetConnection* Connection, FName FunctionName, int64 Bits);
+	// Receivers do not see the size of what they got, only the call
+	void RecordReceivedRpc(UNetConnection* Connection, FName FunctionName);
+	// A replicated property whose value changed since the actor last replicated, sent to every connection it is relevant to
+	void RecordPropertyChange(FName PropertyName);
+
+	// Calls of every function received from one connection since the last reset
+	int64 GetNumReceivedRpcs(const UNetConnection* Connection) const;
+
+	void Dump(FOutputDevice& Ar) const;
+	FString ToJson() const;
+	void Reset();
+
+private:
+	struct FConnectionAccounting
+	{
+		TWeakObjectPtr<UNetConnection> Connection;
+		FString Name;
+		TMap<FName, FNetAccountingCounter> SentRpcs;
+		TMap<FName, FNetAccountingCounter> ReceivedRpcs;
+		// Unacknowledged reliable bunches on the fullest channel, out of RELIABLE_BUFFER
+		int32 ReliableBufferUsed = 0;
+		int32 ReliableBufferPeak = 0;
+	};
+
+	FConnectionAccounting& FindOrAddConnection(UNetConnection* Connection);
+	void SampleReliableBuffers();
+	void RecordCsvStats();
+	bool HandleHttpRequest(const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete);
+
+private:
+	TArray<FConnectionAccounting> Connections;
+	TMap<FName, FNetAccountingCounter> PropertyChanges;
+
+	int32 HttpPort = 0;
+	FHttpRouteHandle HttpRouteHandle;
+};
@@ -0,0 +1,29 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Player/PlayerAnimInstance.h"
+
+void UPlayerAnimInstance::NativeInitializeAnimation()
+{
+	Super::NativeInitializeAnimation();
+	Player = Cast<APlayerBase>(TryGetPawnOwner());
+}
+
+void UPlayerAnimInstance::NativeUpdateAnimation(float DeltaSeconds)
+{
+	Super::NativeUpdateAnimation(DeltaSeconds);
+
+	// The only game thread work, everything else reads the copy
+	if (Player)
+		Snapshot = Player->GetAnimSnapshot();
+}
+
+void UPlayerAnimInstance::NativeThreadSafeUpdateAnimation(float DeltaSeconds)
+{
+	Super::NativeThreadSafeUpdateAnimation(DeltaSeconds);
+
+	GroundSpeed = Snapshot.Velocity.Size2D();
+	bIsInAir = Snapshot.LocomotionState == EPlayerLocomotionState::Falling;
+	bIsSliding = Snapshot.LocomotionState == EPlayerLocomotionState::Sliding;
+	bIsLedgeGrabbing = Snapshot.LocomotionState == EPlayerLocomotionState::LedgeGrabbing;
+}
\ No newline at end of file
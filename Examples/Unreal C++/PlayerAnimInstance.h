@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Animation/AnimInstance.h"
+#include "Player/PlayerBase.h"
+#include "PlayerAnimInstance.generated.h"
+
+/**
+ * Third person animation for APlayerBase. The pawn's locomotion snapshot is copied on the game thread
+ * and everything derived from it is worked out in NativeThreadSafeUpdateAnimation, so many remote players animate in parallel.
+ */
+UCLASS()
+class HORDESHOOTER_API UPlayerAnimInstance : public UAnimInstance
+{
+	GENERATED_BODY()
+
+public:
+	virtual void NativeInitializeAnimation() override;
+	virtual void NativeUpdateAnimation(float DeltaSeconds) override;
+	virtual void NativeThreadSafeUpdateAnimation(float DeltaSeconds) override;
+
+protected:
+	UPROPERTY(BlueprintReadOnly, Category = Locomotion)
+	FPlayerAnimSnapshot Snapshot;
+
+	UPROPERTY(BlueprintReadOnly, Category = Locomotion)
+	float GroundSpeed = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = Locomotion)
+	bool bIsInAir = false;
+
+	UPROPERTY(BlueprintReadOnly, Category = Locomotion)
+	bool bIsSliding = false;
+
+	UPROPERTY(BlueprintReadOnly, Category = Locomotion)
+	bool bIsLedgeGrabbing = false;
+
+private:
+	UPROPERTY(Transient)
+	TObjectPtr<APlayerBase> Player;
+};
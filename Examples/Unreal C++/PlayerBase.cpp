@@ -5,6 +5,7 @@
 
 #include "Player/PlayerBase.h"
 #include "Camera/CameraComponent.h"
+#include "Camera/PlayerCameraManager.h"
 #include "Base/BetterSpringArmComponent.h"
 #include "GameFramework/Controller.h"
 #include "GameFramework/CharacterMovementComponent.h"
@@ -20,15 +21,32 @@
 #include "Curves/CurveVector.h"
 #include "Net/UnrealNetwork.h"
 #include "Base/CustomCharacterMovementComponent.h"
+#include "GameFramework/PlayerState.h"
+#include "Engine/NetConnection.h"
+#include "Player/PlayerNetTestComponent.h"
+#include "Player/PlayerInputReplayComponent.h"
+#include "ProfilingDebugging/MiscTrace.h"
+#include "ProfilingDebugging/TraceAuxiliary.h"
+#include "Engine/OverlapResult.h"
+#include "Player/PlayerLocomotionEventSubsystem.h"
+#include "Base/LagCompensationSubsystem.h"
+#include "Base/MovementCorrectionLog.h"
+#include "Base/NetAccountingSubsystem.h"
 
 DEFINE_LOG_CATEGORY(LogPlayerBase);
 
+DECLARE_STATS_GROUP(TEXT("PlayerBase"), STATGROUP_PlayerBase, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("Construct"), STAT_PlayerBaseConstruct, STATGROUP_PlayerBase);
+DECLARE_CYCLE_STAT(TEXT("Build Class Defaults"), STAT_PlayerBaseBuildClassDefaults, STATGROUP_PlayerBase);
+
 // Sets default values
 APlayerBase::APlayerBase(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get()) :
 	// Set CharacterMovementComponent default class to CustomCharacterMovementComponent
 	Super(ObjectInitializer
 		.SetDefaultSubobjectClass<UCustomCharacterMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
+	SCOPE_CYCLE_COUNTER(STAT_PlayerBaseConstruct);
+
  	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
@@ -38,6 +56,8 @@ APlayerBase::APlayerBase(const FObjectInitializer& ObjectInitializer = FObjectIn
 	// Setup Capsule
 	GetCapsuleComponent()->InitCapsuleSize(40.0f, 96.0f);
 
+	// Cosmetic components, server builds leave them out entirely since nothing is ever rendered there
+#if !UE_SERVER
 	// Setup CameraBoom
 	CameraBoom = CreateDefaultSubobject<UBetterSpringArmComponent>(TEXT("CameraBoom"));
 	CameraBoom->SetupAttachment(GetCapsuleComponent());
@@ -61,6 +81,7 @@ APlayerBase::APlayerBase(const FObjectInitializer& ObjectInitializer = FObjectIn
 	FirstPersonMesh->bCastDynamicShadow = false;
 	FirstPersonMesh->CastShadow = false;
 	FirstPersonMesh->SetCollisionProfileName(TEXT("CharacterMesh"));
+#endif
 
 	// Setup third person mesh
 	USkeletalMeshComponent* ThirdPersonMesh = GetMesh();
@@ -70,33 +91,93 @@ APlayerBase::APlayerBase(const FObjectInitializer& ObjectInitializer = FObjectIn
 	ThirdPersonMesh->bCastHiddenShadow = true;
 	ThirdPersonMesh->SetRelativeLocation(FVector(0.0f, 0.0f, -GetCapsuleComponent()->GetUnscaledCapsuleHalfHeight()));
 
-	// Set up camera pitch angle clamping
-	APlayerCameraManager* CameraManager = UGameplayStatics::GetPlayerCameraManager(this, 0);
-	if (CameraManager)
-	{
-		CameraManager->ViewPitchMax = PitchAngleMax;
-		CameraManager->ViewPitchMin = PitchAngleMin;
-	}
+	// Defaults derived from the components are copied from the class in PostInitializeComponents
+	LocomotionState = EPlayerLocomotionState::Idle;
+}
 
-	// Set up blockers
-	for (int i = 0; i < StaticEnum<EPlayerBlocker>()->GetMaxEnumValue(); i++)
-	{
-		Blockers.Add((EPlayerBlocker)i, TSet<FName>());
-	}
+void APlayerBase::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+	Defaults = GetClassDefaults(GetClass());
+
+	// Walking speeds stay at the class defaults, the movement component scales them for sprinting and speed modifiers
+	GetCustomCharacterMovement()->SetSprintSpeedMultiplier(SprintSpeedMultiplier);
+}
 
-	// Cache / Set default values
-	DefaultWalkSpeed = GetCharacterMovement()->MaxWalkSpeed;
-	DefaultCrouchSpeed = GetCharacterMovement()->MaxWalkSpeedCrouched;
-	DefaultCameraBoomZ = CameraBoom->GetRelativeLocation().Z;
-	DefaultCapsuleHalfHeight = GetCapsuleComponent()->GetUnscaledCapsuleHalfHeight();
-	CrouchCapsuleResizeOffset = (DefaultCapsuleHalfHeight - GetCharacterMovement()->GetCrouchedHalfHeight());
-	SetLocomotionState(EPlayerLocomotionState::Idle);
+namespace
+{
+	// Built the first time an instance of each class initializes
+	TMap<const UClass*, FPlayerClassDefaults> ClassDefaultsCache;
+}
+
+FPlayerClassDefaults APlayerBase::GetClassDefaults(const UClass* Class)
+{
+	check(IsInGameThread());
+#if WITH_EDITOR
+	// Recompiling a Blueprint replaces its class and defaults, so start over
+	static const FDelegateHandle ReinstancedHandle = FCoreUObjectDelegates::OnObjectsReinstanced.AddLambda([](const TMap<UObject*, UObject*>&)
+	{
+		ClassDefaultsCache.Reset();
+	});
+#endif
+
+	if (const FPlayerClassDefaults* CachedDefaults = ClassDefaultsCache.Find(Class))
+		return *CachedDefaults;
+
+	SCOPE_CYCLE_COUNTER(STAT_PlayerBaseBuildClassDefaults);
+	const APlayerBase* ClassDefaultObject = Class->GetDefaultObject<APlayerBase>();
+	const UCharacterMovementComponent* Movement = ClassDefaultObject->GetCharacterMovement();
+	const UCapsuleComponent* Capsule = ClassDefaultObject->GetCapsuleComponent();
+
+	FPlayerClassDefaults& ClassDefaults = ClassDefaultsCache.Add(Class);
+	ClassDefaults.WalkSpeed = Movement->MaxWalkSpeed;
+	ClassDefaults.CrouchSpeed = Movement->MaxWalkSpeedCrouched;
+	ClassDefaults.CameraBoomZ = ClassDefaultObject->CameraBoom ? ClassDefaultObject->CameraBoom->GetRelativeLocation().Z : 0.0f;
+	ClassDefaults.CapsuleHalfHeight = Capsule->GetUnscaledCapsuleHalfHeight();
+	ClassDefaults.CrouchCapsuleResizeOffset = ClassDefaults.CapsuleHalfHeight - Movement->GetCrouchedHalfHeight();
+	return ClassDefaults;
 }
 
 // Called when the game starts or when spawned
 void APlayerBase::BeginPlay()
 {
 	Super::BeginPlay();
+
+	// Physics probes reuse the same query parameters and shapes for every check
+	PhysicsProbe.Init(this, ECC_Visibility, GetCapsuleComponent());
+	LedgeGrabTraceShape = FCollisionShape::MakeBox(FVector(LedgeGrabTraceSize / 2));
+	LedgeGrabDestinationShape = FCollisionShape::MakeCapsule(GetCapsuleComponent()->GetUnscaledCapsuleRadius(), GetCapsuleComponent()->GetUnscaledCapsuleHalfHeight());
+	CeilingProbeShape = FCollisionShape::MakeCapsule(GetCapsuleComponent()->GetUnscaledCapsuleRadius(), Defaults.CapsuleHalfHeight);
+	CeilingProbeDelegate.BindUObject(this, &APlayerBase::OnCeilingProbeComplete);
+
+	LocomotionEvents = GetWorld()->GetSubsystem<UPlayerLocomotionEventSubsystem>();
+	NetAccounting = GetWorld()->GetSubsystem<UNetAccountingSubsystem>();
+
+#if !UE_BUILD_SHIPPING
+	// Automated network test runs (-NetTestLoops, -NetTestReport) script and measure players from a separate component
+	if (UPlayerNetTestComponent::IsRequested())
+		NewObject<UPlayerNetTestComponent>(this, TEXT("NetTest"))->RegisterComponent();
+#endif
+
+	// A regular build running as a dedicated server still has the cosmetic components, put them to sleep
+	if (IsNetMode(NM_DedicatedServer))
+		ConfigureForDedicatedServer();
+
+	// The server keeps a history of where players were to check their ledge grabs against
+	if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+		LagCompensation->Register(GetCapsuleComponent());
+
+	// Place the camera for the current crouch state, after that it only moves during crouch transitions
+	SetCrouchCameraEndpoints(GetCharacterMovement()->IsCrouching());
+	UpdateCameraBoomLocation();
+}
+
+void APlayerBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+		LagCompensation->Unregister(GetCapsuleComponent());
+
+	Super::EndPlay(EndPlayReason);
 }
 
 // Called every frame
@@ -104,30 +185,43 @@ void APlayerBase::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
+	// Forget presses too old for any buffer window
+	InputBuffer.Prune(FPlatformTime::Seconds(), FMath::Max(JumpBufferTime, CoyoteTime));
+
+	// Look
+	ApplyLookInput(DeltaTime);
+
 	// Locomotion State Machine
 	UpdateLocomotionState();
 
-	// Crouch camera
-	CrouchSpeed = FMath::Max(CrouchSpeed, 0.0001f);
-	if (GetCharacterMovement()->IsCrouching())
-		CrouchCameraLerpProgress = FMath::Min(CrouchCameraLerpProgress + (DeltaTime * (1.0f / CrouchSpeed)), 1);
-	else
-		CrouchCameraLerpProgress = FMath::Max(CrouchCameraLerpProgress - (DeltaTime * (1.0f / CrouchSpeed)), 0);
-
-	CameraBoom->SetRelativeLocation(GetCrouchPositionRelativeCameraBoomPosition());
+	// Pressed and released edges only last for the frame they happened in
+	HotState.InputState.ClearEdges();
 
-	// Print state to the screen
-	if (GEngine)
-	{
-		FString LocalRoleString = UEnum::GetValueAsString(GetLocalRole());
-		FString ActorName = GetName();
-		FString LocomotionStateString = UEnum::GetValueAsString(LocomotionState);
-		FString MovementModeString = UEnum::GetValueAsString(GetCharacterMovement()->MovementMode);
-		GEngine->AddOnScreenDebugMessage(-1, 0.0f, FColor::Cyan, 
-			FString::Printf(TEXT("%s | %s | %s | %s"), *ActorName, *LocalRoleString, *LocomotionStateString, *MovementModeString));
-	}
+	// Crouch camera
+	UpdateCrouchCamera(DeltaTime);
 }
 
+const APlayerBase::FInputActionBinding APlayerBase::InputActionBindings[] =
+{
+	{ &APlayerBase::MoveAction, ETriggerEvent::Triggered, &APlayerBase::InputActionMove },
+	{ &APlayerBase::MoveAction, ETriggerEvent::Completed, &APlayerBase::InputActionMove },
+	{ &APlayerBase::LookAction, ETriggerEvent::Triggered, &APlayerBase::InputActionLook },
+	{ &APlayerBase::JumpAction, ETriggerEvent::Started, &APlayerBase::InputActionBeginJump },
+	{ &APlayerBase::JumpAction, ETriggerEvent::Completed, &APlayerBase::InputActionEndJump },
+	{ &APlayerBase::PrimaryFireAction, ETriggerEvent::Started, &APlayerBase::InputActionPrimaryFire },
+	{ &APlayerBase::AimDownSightsAction, ETriggerEvent::Started, &APlayerBase::InputActionBeginAimDownSights },
+	{ &APlayerBase::AimDownSightsAction, ETriggerEvent::Completed, &APlayerBase::InputActionEndAimDownSights },
+	{ &APlayerBase::ReloadAction, ETriggerEvent::Started, &APlayerBase::InputActionReload },
+	{ &APlayerBase::SprintAction, ETriggerEvent::Started, &APlayerBase::InputActionBeginSprint },
+	{ &APlayerBase::SprintAction, ETriggerEvent::Completed, &APlayerBase::InputActionEndSprint },
+	{ &APlayerBase::CrouchAction, ETriggerEvent::Started, &APlayerBase::InputActionBeginCrouch },
+	{ &APlayerBase::CrouchAction, ETriggerEvent::Completed, &APlayerBase::InputActionEndCrouch },
+	{ &APlayerBase::InteractAction, ETriggerEvent::Started, &APlayerBase::InputActionInteract },
+	{ &APlayerBase::NextWeaponAction, ETriggerEvent::Started, &APlayerBase::InputActionNextWeapon },
+	{ &APlayerBase::PreviousWeaponAction, ETriggerEvent::Started, &APlayerBase::InputActionPreviousWeapon },
+	{ &APlayerBase::ToggleFlashlightAction, ETriggerEvent::Started, &APlayerBase::InputActionToggleFlashlight },
+};
+
 // Called to bind functionality to input
 void APlayerBase::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
 {
@@ -136,6 +230,13 @@ void APlayerBase::SetupPlayerInputComponent(UInputComponent* PlayerInputComponen
 	// Add Input Mapping Context
 	if (APlayerController* PlayerController = Cast<APlayerController>(GetController()))
 	{
+		// Set up camera pitch angle clamping, the camera manager only exists once a local controller has possessed us
+		if (APlayerCameraManager* CameraManager = PlayerController->PlayerCameraManager)
+		{
+			CameraManager->ViewPitchMax = PitchAngleMax;
+			CameraManager->ViewPitchMin = PitchAngleMin;
+		}
+
 		if (UEnhancedInputLocalPlayerSubsystem* Subsystem = ULocalPlayer::GetSubsystem<UEnhancedInputLocalPlayerSubsystem>(PlayerController->GetLocalPlayer()))
 		{
 			Subsystem->AddMappingContext(DefaultMappingContext, 0);
@@ -146,34 +247,210 @@ void APlayerBase::SetupPlayerInputComponent(UInputComponent* PlayerInputComponen
 	if (UEnhancedInputComponent* EnhancedInputComponent = Cast<UEnhancedInputComponent>(PlayerInputComponent))
 	{
 		// Bind Input Actions
-		EnhancedInputComponent->BindAction(MoveAction, ETriggerEvent::Triggered, this, &APlayerBase::InputActionMove);
-		EnhancedInputComponent->BindAction(MoveAction, ETriggerEvent::Completed, this, &APlayerBase::InputActionMove);
-		EnhancedInputComponent->BindAction(LookAction, ETriggerEvent::Triggered, this, &APlayerBase::InputActionLook);
-		EnhancedInputComponent->BindAction(JumpAction, ETriggerEvent::Started, this, &APlayerBase::InputActionBeginJump);
-		EnhancedInputComponent->BindAction(JumpAction, ETriggerEvent::Completed, this, &APlayerBase::InputActionEndJump);
-		EnhancedInputComponent->BindAction(PrimaryFireAction, ETriggerEvent::Started, this, &APlayerBase::InputActionPrimaryFire);
-		EnhancedInputComponent->BindAction(AimDownSightsAction, ETriggerEvent::Started, this, &APlayerBase::InputActionBeginAimDownSights);
-		EnhancedInputComponent->BindAction(AimDownSightsAction, ETriggerEvent::Completed, this, &APlayerBase::InputActionEndAimDownSights);
-		EnhancedInputComponent->BindAction(ReloadAction, ETriggerEvent::Started, this, &APlayerBase::InputActionReload);
-		EnhancedInputComponent->BindAction(SprintAction, ETriggerEvent::Started, this, &APlayerBase::InputActionBeginSprint);
-		EnhancedInputComponent->BindAction(SprintAction, ETriggerEvent::Completed, this, &APlayerBase::InputActionEndSprint);
-		EnhancedInputComponent->BindAction(CrouchAction, ETriggerEvent::Started, this, &APlayerBase::InputActionBeginCrouch);
-		EnhancedInputComponent->BindAction(CrouchAction, ETriggerEvent::Completed, this, &APlayerBase::InputActionEndCrouch);
-		EnhancedInputComponent->BindAction(InteractAction, ETriggerEvent::Started, this, &APlayerBase::InputActionInteract);
-		EnhancedInputComponent->BindAction(NextWeaponAction, ETriggerEvent::Started, this, &APlayerBase::InputActionNextWeapon);
-		EnhancedInputComponent->BindAction(PreviousWeaponAction, ETriggerEvent::Started, this, &APlayerBase::InputActionPreviousWeapon);
-		EnhancedInputComponent->BindAction(ToggleFlashlightAction, ETriggerEvent::Started, this, &APlayerBase::InputActionToggleFlashlight);
+		for (const FInputActionBinding& Binding : InputActionBindings)
+		{
+			EnhancedInputComponent->BindAction(this->*Binding.Action, Binding.TriggerEvent, this, Binding.Handler);
+		}
 	}
 	else
 	{
 		UE_LOG(LogPlayerBase, Error, TEXT("'%s' Failed to find an Enhanced Input component!"), *GetNameSafe(this));
 	}
+
+#if !UE_BUILD_SHIPPING
+	// Input recording and replay run from a separate component on locally controlled players
+	UPlayerInputReplayComponent::OnPlayerPossessed(this);
+#endif
+}
+
+void APlayerBase::ResetForReuse()
+{
+	UCapsuleComponent* Capsule = GetCapsuleComponent();
+	const UCapsuleComponent* DefaultCapsule = GetClass()->GetDefaultObject<APlayerBase>()->GetCapsuleComponent();
+
+	// Stand back up without checking for room, OnEndCrouch restores the mesh offset and camera
+	UCharacterMovementComponent* Movement = GetCharacterMovement();
+	Movement->bWantsToCrouch = false;
+	GetCustomCharacterMovement()->SetWantsToSlide(false);
+	GetCustomCharacterMovement()->SetWantsToSprint(false);
+	if (bIsCrouched)
+	{
+		const float HalfHeightAdjust = Defaults.CapsuleHalfHeight - Capsule->GetUnscaledCapsuleHalfHeight();
+		Capsule->SetCapsuleSize(DefaultCapsule->GetUnscaledCapsuleRadius(), Defaults.CapsuleHalfHeight);
+		bIsCrouched = false;
+		OnEndCrouch(HalfHeightAdjust, HalfHeightAdjust * Capsule->GetShapeScale());
+	}
+
+	// Ledge grabs ignore world static while they move the capsule through the ledge
+	Capsule->SetCollisionResponseToChannels(DefaultCapsule->GetCollisionResponseToChannels());
+
+	Movement->StopMovementImmediately();
+	Movement->MaxWalkSpeed = Defaults.WalkSpeed;
+	Movement->MaxWalkSpeedCrouched = Defaults.CrouchSpeed;
+	ResetJumpState();
+	GetCustomCharacterMovement()->ResetCoyoteTime();
+
+	// Handles still held from the previous life release nothing once the generation moves on
+	LedgeGrabBlockers.Release();
+	NamedBlockers.Reset();
+	for (uint16& Count : BlockerCounts)
+		Count = 0;
+	ActiveBlockerMask = 0;
+	BlockerGeneration++;
+	GetCustomCharacterMovement()->SetBlockerMask(0);
+	MoveSpeedModifiers.Reset();
+	ServerModifiers = FPlayerServerModifiers();
+	ApplyServerModifiers();
+	InputBuffer.Clear();
+	GetCustomCharacterMovement()->SetInputBits(0);
+
+	HotState = FPlayerHotState();
+	SetCrouchCameraEndpoints(false);
+	UpdateCameraBoomLocation();
+	CeilingProbeHandle = FTraceHandle();
+	LastCeilingProbeTime = -1.0f;
+
+	LedgeGrabLedgeTransform = FTransform();
+	LedgeGrabCapsuleDestination = FTransform();
+	LedgeGrabStartTransform = FTransform();
+	if (HasAuthority())
+		bServerLedgeGrabCheckSucceeded = false;
+
+	// Set directly rather than through SetLocomotionState, a pawn leaving the game has no state change to announce
+	LocomotionState = EPlayerLocomotionState::Idle;
+	LocomotionStateStartTime = GetWorld()->GetTimeSeconds();
+}
+
+void APlayerBase::FillCorrectionRecord(FMovementCorrectionRecord& Record) const
+{
+	Record.PlayerId = GetPlayerState() ? GetPlayerState()->GetPlayerId() : INDEX_NONE;
+	Record.LocomotionState = (uint8)LocomotionState;
+	// What the movement component simulated with, on the server that includes the blockers the client sent
+	Record.BlockerMask = GetCustomCharacterMovement()->GetEffectiveBlockerMask();
+	Record.SpeedModifier = GetCustomCharacterMovement()->GetSpeedScale();
+}
+
+void APlayerBase::ConfigureForDedicatedServer()
+{
+	bCosmeticComponentsDormant = true;
+
+	// Detaching the boom stops capsule moves from propagating transform updates down the camera hierarchy
+	if (CameraBoom)
+	{
+		CameraBoom->SetComponentTickEnabled(false);
+		CameraBoom->DetachFromComponent(FDetachmentTransformRules::KeepRelativeTransform);
+	}
+	if (Camera)
+		Camera->SetComponentTickEnabled(false);
+	if (FirstPersonMesh)
+	{
+		FirstPersonMesh->SetComponentTickEnabled(false);
+		FirstPersonMesh->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::OnlyTickPoseWhenRendered;
+		FirstPersonMesh->bNoSkeletonUpdate = true;
+
+		// Nobody sees the arms on a server, so keep them out of physics and every trace and overlap query
+		FirstPersonMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	}
+
+	// Nothing is rendered on a dedicated server, so the body mesh only needs to keep montages and their root motion going
+	GetMesh()->VisibilityBasedAnimTickOption = DedicatedServerMeshTickOption;
+}
+
+UCustomCharacterMovementComponent* APlayerBase::GetCustomCharacterMovement() const
+{
+	return CastChecked<UCustomCharacterMovementComponent>(GetCharacterMovement());
 }
 
 void APlayerBase::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 	DOREPLIFETIME(APlayerBase, bServerLedgeGrabCheckSucceeded);
+	DOREPLIFETIME_CONDITION(APlayerBase, LocomotionState, COND_SkipOwner);
+	DOREPLIFETIME_CONDITION(APlayerBase, ServerModifiers, COND_OwnerOnly);
+}
+
+FPlayerAnimSnapshot APlayerBase::GetAnimSnapshot() const
+{
+	FPlayerAnimSnapshot Snapshot;
+	Snapshot.LocomotionState = LocomotionState;
+	Snapshot.StateTime = GetWorld()->GetTimeSeconds() - LocomotionStateStartTime;
+	Snapshot.CrouchBlend = HotState.CrouchCameraLerpProgress;
+	Snapshot.Velocity = GetVelocity();
+
+	// Only the owner runs the ledge grab, everyone else works out how far through it we should be
+	if (LocomotionState == EPlayerLocomotionState::LedgeGrabbing)
+		Snapshot.LedgeGrabProgress = IsLocallyControlled() ? HotState.LedgeGrabProgress : FMath::Clamp(Snapshot.StateTime / FMath::Max(0.0001f, LedgeGrabSpeed), 0.0f, 1.0f);
+
+	return Snapshot;
+}
+
+void APlayerBase::Landed(const FHitResult& Hit)
+{
+	Super::Landed(Hit);
+	MarkLocomotionStateDirty();
+
+	// A confirmed ledge grab the client never started must not carry over to the next fall
+	if (HasAuthority())
+		bServerLedgeGrabCheckSucceeded = false;
+}
+
+void APlayerBase::OnMovementModeChanged(EMovementMode PrevMovementMode, uint8 PreviousCustomMode)
+{
+	Super::OnMovementModeChanged(PrevMovementMode, PreviousCustomMode);
+	MarkLocomotionStateDirty();
+
+	// Slides are run by the movement component, so they start and end with its movement mode
+	const bool bWasSliding = PrevMovementMode == MOVE_Custom && PreviousCustomMode == CMOVE_Slide;
+	const bool bIsSliding = GetCustomCharacterMovement()->IsSliding();
+	if (bIsSliding && !bWasSliding)
+		PushLocomotionEvent(EPlayerLocomotionEventType::SlideStart, LocomotionState);
+	else if (bWasSliding && !bIsSliding)
+		PushLocomotionEvent(EPlayerLocomotionEventType::SlideEnd, LocomotionState);
+}
+
+void APlayerBase::OnJumped_Implementation()
+{
+	Super::OnJumped_Implementation();
+	GetCustomCharacterMovement()->NotifyJumped();
+}
+
+void APlayerBase::OnStartCrouch(float HalfHeightAdjust, float ScaledHalfHeightAdjust)
+{
+	Super::OnStartCrouch(HalfHeightAdjust, ScaledHalfHeightAdjust);
+	MarkLocomotionStateDirty();
+
+	// We were standing here a moment ago, assume there is room until the first ceiling probe says otherwise
+	HotState.bCanUnCrouch = true;
+	LastCeilingProbeTime = GetWorld()->GetTimeSeconds();
+
+	// The capsule just shrank, move the camera onto the crouched endpoints so it does not jump
+	SetCrouchCameraEndpoints(true);
+	UpdateCameraBoomLocation();
+}
+
+void APlayerBase::OnEndCrouch(float HalfHeightAdjust, float ScaledHalfHeightAdjust)
+{
+	Super::OnEndCrouch(HalfHeightAdjust, ScaledHalfHeightAdjust);
+	MarkLocomotionStateDirty();
+
+	// Drop any probe still in flight, its result is for a capsule we no longer have
+	CeilingProbeHandle = FTraceHandle();
+
+	SetCrouchCameraEndpoints(false);
+	UpdateCameraBoomLocation();
+}
+
+bool APlayerBase::CanJumpInternal_Implementation() const
+{
+	// Checked against the blockers sent with the move so the server refuses the same jumps
+	if (GetCustomCharacterMovement()->IsBlocked(EPlayerBlocker::Jump))
+		return false;
+
+	if (Super::CanJumpInternal_Implementation())
+		return true;
+
+	// Allow the first jump shortly after walking off a ledge
+	return GetCustomCharacterMovement()->CanCoyoteJump(CoyoteTime);
 }
 
 /**
@@ -182,35 +459,109 @@ void APlayerBase::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifet
  * --------------------
  */
 #pragma region RPCs
-void APlayerBase::Server_SetWalkSpeed_Implementation(float Speed)
-{
-	GetCharacterMovement()->MaxWalkSpeed = Speed;
-}
-
 void APlayerBase::Server_PrepareForLedgeGrab_Implementation()
 {
+	CountReceivedRpc(GET_FUNCTION_NAME_CHECKED(APlayerBase, Server_PrepareForLedgeGrab));
 	PrepareForLedgeGrab();
 }
 
 void APlayerBase::Server_CleanUpLedgeGrab_Implementation()
 {
+	CountReceivedRpc(GET_FUNCTION_NAME_CHECKED(APlayerBase, Server_CleanUpLedgeGrab));
 	CleanUpLedgeGrab();
 }
 
 void APlayerBase::Server_SetActorLocation_Implementation(FVector Location)
 {
+	CountReceivedRpc(GET_FUNCTION_NAME_CHECKED(APlayerBase, Server_SetActorLocation));
 	SetActorLocation(Location);
 }
 
 void APlayerBase::Server_SetActorRotation_Implementation(FRotator Rotation)
 {
+	CountReceivedRpc(GET_FUNCTION_NAME_CHECKED(APlayerBase, Server_SetActorRotation));
 	SetActorRotation(Rotation);
 }
 
-void APlayerBase::Server_CheckLedgeGrab_Implementation()
+void APlayerBase::Server_CheckLedgeGrab_Implementation(float ClientTimeStamp)
 {
+	CountReceivedRpc(GET_FUNCTION_NAME_CHECKED(APlayerBase, Server_CheckLedgeGrab));
+
+	// Check from where the client was when it found the ledge. The server has usually simulated up to that move already,
+	// so this is at or near the present
+	const ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>();
+	FTransform RewoundTransform = GetActorTransform();
+	if (LagCompensation)
+		LagCompensation->SampleTransform(GetCapsuleComponent(), GetServerTimeForClientTimeStamp(ClientTimeStamp), RewoundTransform);
+
+	// Moving things are checked where the client saw them, which is behind the server by its latency and smoothing
+	const double ViewTime = GetWorld()->GetTimeSeconds() - GetClientViewRewindTime();
+	const FLagCompensationScope RewindScope(LagCompensation, ViewTime, RewoundTransform.GetLocation(), LedgeGrabRewindRadius, this);
 	FTransform Throwaway;
-	bServerLedgeGrabCheckSucceeded = CheckLedgeGrab(Throwaway);
+	bServerLedgeGrabCheckSucceeded = CheckLedgeGrab(RewoundTransform, Throwaway);
+}
+
+void APlayerBase::CountReceivedRpc(FName FunctionName)
+{
+	if (NetAccounting && UNetAccountingSubsystem::IsEnabled())
+		NetAccounting->RecordReceivedRpc(GetNetConnection(), FunctionName);
+}
+
+bool APlayerBase::CallRemoteFunction(UFunction* Function, void* Parameters, FOutParmRec* OutParms, FFrame* Stack)
+{
+	UNetConnection* Connection = GetNetConnection();
+	if (!NetAccounting || !Connection || !UNetAccountingSubsystem::IsEnabled())
+		return Super::CallRemoteFunction(Function, Parameters, OutParms, Stack);
+
+	// Reliable and unreliable RPCs are written into the send buffer straight away, covering the movement RPCs too
+	const int32 OutPacketId = Connection->OutPacketId;
+	const int64 SendBufferBits = Connection->SendBuffer.GetNumBits();
+	const bool bProcessed = Super::CallRemoteFunction(Function, Parameters, OutParms, Stack);
+
+	// If the buffer filled up and was flushed part way, only the part in the new packet is counted
+	const int64 Bits = Connection->OutPacketId == OutPacketId ? Connection->SendBuffer.GetNumBits() - SendBufferBits : Connection->SendBuffer.GetNumBits();
+	NetAccounting->RecordSentRpc(Connection, Function->GetFName(), Bits);
+	return bProcessed;
+}
+
+void APlayerBase::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	// Called once per net update, so a change here is one that is about to go out
+	if (!NetAccounting || !UNetAccountingSubsystem::IsEnabled())
+		return;
+
+	if (bServerLedgeGrabCheckSucceeded != bLastReplicatedLedgeGrabCheckSucceeded)
+	{
+		NetAccounting->RecordPropertyChange(GET_MEMBER_NAME_CHECKED(APlayerBase, bServerLedgeGrabCheckSucceeded));
+		bLastReplicatedLedgeGrabCheckSucceeded = bServerLedgeGrabCheckSucceeded;
+	}
+	if (LocomotionState != LastReplicatedLocomotionState)
+	{
+		NetAccounting->RecordPropertyChange(GET_MEMBER_NAME_CHECKED(APlayerBase, LocomotionState));
+		LastReplicatedLocomotionState = LocomotionState;
+	}
+	if (ServerModifiers != LastReplicatedServerModifiers)
+	{
+		NetAccounting->RecordPropertyChange(GET_MEMBER_NAME_CHECKED(APlayerBase, ServerModifiers));
+		LastReplicatedServerModifiers = ServerModifiers;
+	}
+}
+
+void APlayerBase::OnRep_LocomotionState(EPlayerLocomotionState PreviousState)
+{
+	LocomotionStateStartTime = GetWorld()->GetTimeSeconds();
+	BroadcastLocomotionStateChanged(PreviousState, LocomotionState);
+}
+
+void APlayerBase::OnRep_ServerModifiers()
+{
+	ApplyServerModifiers();
+}
+
+void APlayerBase::OnLocomotionStateChangedBenchmark(EPlayerLocomotionState PreviousState, EPlayerLocomotionState NewState, APlayerBase* Player)
+{
 }
 #pragma endregion
 
@@ -222,76 +573,165 @@ void APlayerBase::Server_CheckLedgeGrab_Implementation()
 #pragma region Blockers
 void APlayerBase::AddBlocker(EPlayerBlocker BlockerType, FName BlockerName)
 {
-	Blockers[BlockerType].Add(BlockerName);
+	AddBlockers(PlayerBlockers::GetBit(BlockerType), BlockerName);
 }
 
 int APlayerBase::RemoveBlocker(EPlayerBlocker BlockerType, FName BlockerName)
 {
-	return Blockers[BlockerType].Remove(BlockerName);
+	return RemoveBlockers(PlayerBlockers::GetBit(BlockerType), BlockerName);
 }
 
 bool APlayerBase::HasBlocker(EPlayerBlocker BlockerType, FName BlockerName)
 {
-	return Blockers[BlockerType].Contains(BlockerName);
+	return (NamedBlockers.FindRef(BlockerName) & PlayerBlockers::GetBit(BlockerType)) != 0;
 }
 
 bool APlayerBase::HasAnyBlocker(EPlayerBlocker BlockerType)
 {
-	return !Blockers[BlockerType].IsEmpty();
+	return (GetActiveBlockerMask() & PlayerBlockers::GetBit(BlockerType)) != 0;
 }
 
 int APlayerBase::ClearBlockers(EPlayerBlocker BlockerType)
 {
-	int NumRemoved = Blockers[BlockerType].Num();
-	Blockers[BlockerType].Empty();
+	// Only clears named blockers, handles keep theirs until released
+	const FPlayerBlockerMask Bit = PlayerBlockers::GetBit(BlockerType);
+	int NumRemoved = 0;
+	for (auto It = NamedBlockers.CreateIterator(); It; ++It)
+	{
+		if (!(It.Value() & Bit))
+			continue;
+
+		It.Value() &= ~Bit;
+		if (!It.Value())
+			It.RemoveCurrent();
+		NumRemoved++;
+	}
+	AdjustBlockerCounts(NumRemoved ? Bit : 0, -NumRemoved);
 	return NumRemoved;
 }
 
 int APlayerBase::ClearAllBlockersByName(FName Name)
 {
-	int NumCleared = 0;
-	for (int i = 0; i < StaticEnum<EPlayerBlocker>()->GetMaxEnumValue(); i++)
-	{
-		EPlayerBlocker Blocker = static_cast<EPlayerBlocker>(i);
-		NumCleared += RemoveBlocker(Blocker, Name);
-	}
-	return NumCleared;
+	return RemoveBlockers(PlayerBlockers::AllMask, Name);
 }
 
 void APlayerBase::AddMultiBlocker(const TArray<EPlayerBlocker>& BlockerTypes, FName BlockerName)
 {
-	for (EPlayerBlocker BlockerType : BlockerTypes)
-	{
-		Blockers[BlockerType].Add(BlockerName);
-	}
+	AddBlockers(PlayerBlockers::MakeMask(BlockerTypes), BlockerName);
 }
 
 int APlayerBase::RemoveMultiBlocker(const TArray<EPlayerBlocker>& BlockerTypes, FName BlockerName)
 {
-	int NumRemoved = 0;
-	for (EPlayerBlocker BlockerType : BlockerTypes)
+	return RemoveBlockers(PlayerBlockers::MakeMask(BlockerTypes), BlockerName);
+}
+
+void APlayerBase::AddBlockers(FPlayerBlockerMask Mask, FName BlockerName)
+{
+	// A name holds each blocker type once, adding it again changes nothing
+	FPlayerBlockerMask& NamedMask = NamedBlockers.FindOrAdd(BlockerName);
+	const FPlayerBlockerMask Added = Mask & ~NamedMask;
+	NamedMask |= Added;
+	AdjustBlockerCounts(Added, 1);
+}
+
+int APlayerBase::RemoveBlockers(FPlayerBlockerMask Mask, FName BlockerName)
+{
+	FPlayerBlockerMask* NamedMask = NamedBlockers.Find(BlockerName);
+	if (!NamedMask)
+		return 0;
+
+	const FPlayerBlockerMask Removed = Mask & *NamedMask;
+	*NamedMask &= ~Removed;
+	if (!*NamedMask)
+		NamedBlockers.Remove(BlockerName);
+	AdjustBlockerCounts(Removed, -1);
+	return FMath::CountBits(Removed);
+}
+
+FPlayerBlockerHandle APlayerBase::AcquireBlockers(FPlayerBlockerMask Mask)
+{
+	if (!Mask)
+		return FPlayerBlockerHandle();
+
+	AdjustBlockerCounts(Mask, 1);
+	return FPlayerBlockerHandle(this, Mask, BlockerGeneration);
+}
+
+void APlayerBase::ReleaseBlockers(FPlayerBlockerMask Mask, uint32 Generation)
+{
+	if (Generation == BlockerGeneration)
+		AdjustBlockerCounts(Mask, -1);
+}
+
+void APlayerBase::AdjustBlockerCounts(FPlayerBlockerMask Mask, int32 Delta)
+{
+	if (!Mask)
+		return;
+
+	for (uint32 Remaining = Mask; Remaining; Remaining &= Remaining - 1)
 	{
-		NumRemoved += Blockers[BlockerType].Remove(BlockerName);
+		const uint32 Index = FMath::CountTrailingZeros(Remaining);
+		checkSlow(Delta > 0 || BlockerCounts[Index] >= -Delta);
+		BlockerCounts[Index] += Delta;
+		if (BlockerCounts[Index])
+			ActiveBlockerMask |= 1 << Index;
+		else
+			ActiveBlockerMask &= ~(1 << Index);
 	}
-	return NumRemoved;
+
+	if (HasAuthority())
+	{
+		// Blockers added on the server reach the owner through ServerModifiers
+		ServerModifiers.BlockerMask = ActiveBlockerMask;
+		ApplyServerModifiers();
+	}
+	else
+	{
+		// The movement component sends the mask with every move so the server simulates with the same blockers
+		GetCustomCharacterMovement()->SetBlockerMask(ActiveBlockerMask);
+	}
+	MarkLocomotionStateDirty();
 }
 #pragma endregion
 
-void APlayerBase::AddMoveSpeedModifier(const FString& Key, float Value)
+void APlayerBase::AddMoveSpeedModifier(FName Key, float Value)
 {
-	if (MoveSpeedModifiers.Contains(Key))
+	// A client's modifier would never reach the server, which would correct it straight back
+	if (!HasAuthority())
 	{
-		MoveSpeedModifiers[Key] = Value;
+		UE_LOG(LogPlayerBase, Warning, TEXT("'%s' Ignored speed modifier %s added without authority"), *GetNameSafe(this), *Key.ToString());
+		return;
 	}
-	else
+
+	MoveSpeedModifiers.Add(Key, Value);
+	OnMoveSpeedModifiersChanged();
+}
+
+void APlayerBase::RemoveMoveSpeedModifier(FName Key)
+{
+	if (!HasAuthority())
 	{
-		MoveSpeedModifiers.Add(Key, Value);
+		UE_LOG(LogPlayerBase, Warning, TEXT("'%s' Ignored speed modifier %s removed without authority"), *GetNameSafe(this), *Key.ToString());
+		return;
 	}
+
+	if (MoveSpeedModifiers.Remove(Key))
+		OnMoveSpeedModifiersChanged();
 }
 
-void APlayerBase::RemoveMoveSpeedModifier(const FString& Key)
+void APlayerBase::OnMoveSpeedModifiersChanged()
 {
-	MoveSpeedModifiers.Remove(Key);
+	ServerModifiers.SetSpeedScale(GetMoveSpeedModifierProduct());
+	ApplyServerModifiers();
+}
+
+void APlayerBase::ApplyServerModifiers()
+{
+	// The server simulates with the quantized scale too, so both sides move at the same speed
+	UCustomCharacterMovementComponent* Movement = GetCustomCharacterMovement();
+	Movement->SetServerBlockerMask(ServerModifiers.BlockerMask);
+	Movement->SetSpeedScale(ServerModifiers.GetSpeedScale());
+	MarkLocomotionStateDirty();
 }
 
 /**
@@ -302,75 +742,133 @@ void APlayerBase::RemoveMoveSpeedModifier(const FString& Key)
 #pragma region INPUT_ACTIONS
 inline void APlayerBase::InputActionMove(const FInputActionValue& Value)
 {
-	MoveInput = Value.Get<FVector2D>();
+	HotState.MoveInput = Value.Get<FVector2D>();
 }
 void APlayerBase::InputActionLook(const FInputActionValue& Value)
 {
-	LookInput = Value.Get<FVector2D>();
-
-	// If no controller, no input, or we have a look blocker, return
-	if (!Controller || LookInput.SizeSquared() == 0 || HasAnyBlocker(EPlayerBlocker::Look))
-		return;
-
-	AddControllerYawInput(LookInput.X * LookSensitivity);
-	AddControllerPitchInput(-LookInput.Y * LookSensitivity);
+	// Accumulate raw deltas, they are applied once per frame in ApplyLookInput
+	HotState.LookInput = Value.Get<FVector2D>();
+	HotState.PendingLookInput += HotState.LookInput;
 }
 void APlayerBase::InputActionBeginJump(const FInputActionValue& Value)
 {
-	bJumpInput = true;
+	SetInputActionHeld(EPlayerInputAction::Jump, true);
 }
 void APlayerBase::InputActionEndJump(const FInputActionValue& Value)
 {
-	bJumpInput = false;
+	SetInputActionHeld(EPlayerInputAction::Jump, false);
 	StopJumping();
 }
 void APlayerBase::InputActionPrimaryFire(const FInputActionValue& Value)
 {
-	bPrimaryFireInput = Value.Get<bool>();
+	PressInputAction(EPlayerInputAction::PrimaryFire);
 }
 void APlayerBase::InputActionBeginAimDownSights(const FInputActionValue& Value)
 {
-	bAimDownSightsInput = Value.Get<bool>();
+	SetInputActionHeld(EPlayerInputAction::AimDownSights, true);
 }
 void APlayerBase::InputActionEndAimDownSights(const FInputActionValue& Value)
 {
-	bAimDownSightsInput = Value.Get<bool>();
+	SetInputActionHeld(EPlayerInputAction::AimDownSights, false);
 }
 void APlayerBase::InputActionReload(const FInputActionValue& Value)
 {
-	bReloadInput = Value.Get<bool>();
+	PressInputAction(EPlayerInputAction::Reload);
 }
 void APlayerBase::InputActionBeginSprint(const FInputActionValue& Value)
 {
-	bSprintInput = true;
+	SetInputActionHeld(EPlayerInputAction::Sprint, true);
 }
 void APlayerBase::InputActionEndSprint(const FInputActionValue& Value)
 {
-	bSprintInput = false;
+	SetInputActionHeld(EPlayerInputAction::Sprint, false);
 }
 void APlayerBase::InputActionBeginCrouch(const FInputActionValue& Value)
 {
-	bCrouchInput = true;
+	SetInputActionHeld(EPlayerInputAction::Crouch, true);
 }
 void APlayerBase::InputActionEndCrouch(const FInputActionValue& Value)
 {
-	bCrouchInput = false;
+	SetInputActionHeld(EPlayerInputAction::Crouch, false);
 }
 void APlayerBase::InputActionInteract(const FInputActionValue& Value)
 {
-	bInteractInput = Value.Get<bool>();
+	PressInputAction(EPlayerInputAction::Interact);
 }
 void APlayerBase::InputActionNextWeapon(const FInputActionValue& Value)
 {
-	bNextWeaponInput = Value.Get<bool>();
+	PressInputAction(EPlayerInputAction::NextWeapon);
 }
 void APlayerBase::InputActionPreviousWeapon(const FInputActionValue& Value)
 {
-	bPreviousWeaponInput = Value.Get<bool>();
+	PressInputAction(EPlayerInputAction::PreviousWeapon);
 }
 void APlayerBase::InputActionToggleFlashlight(const FInputActionValue& Value)
 {
-	bToggleFlashlightInput = Value.Get<bool>();
+	PressInputAction(EPlayerInputAction::ToggleFlashlight);
+}
+
+void APlayerBase::SetInputActionHeld(EPlayerInputAction Action, bool bHeld)
+{
+	if (!HotState.InputState.SetHeld(Action, bHeld))
+		return;
+
+	RecordInputEvent(Action, bHeld);
+	MarkLocomotionStateDirty();
+
+	// The movement component saves the held word into each move it sends
+	GetCustomCharacterMovement()->SetInputBits(HotState.InputState.Held);
+}
+
+void APlayerBase::PressInputAction(EPlayerInputAction Action)
+{
+	HotState.InputState.Press(Action);
+	RecordInputEvent(Action, true);
+	MarkLocomotionStateDirty();
+}
+
+void APlayerBase::ApplyLookInput(float DeltaTime)
+{
+	const FVector2D LookDelta = HotState.PendingLookInput;
+	HotState.PendingLookInput = FVector2D::ZeroVector;
+
+	// If no controller, no input, or we have a look blocker, drop this frame's look input
+	if (!Controller || LookDelta.IsZero() || Controller->IsLookInputIgnored() || HasAnyBlocker(EPlayerBlocker::Look))
+		return;
+
+	// Same scales AddControllerYawInput/AddControllerPitchInput would apply, including the controller's legacy input scales
+	float YawScale = LookSensitivity;
+	float PitchScale = -LookSensitivity;
+	if (const APlayerController* PlayerController = Cast<APlayerController>(Controller))
+	{
+		YawScale *= PlayerController->GetDeprecatedInputYawScale();
+		PitchScale *= PlayerController->GetDeprecatedInputPitchScale();
+	}
+
+	// Set the control rotation directly rather than through AddControllerYawInput/AddControllerPitchInput,
+	// the controller has already processed its rotation input this frame and would only apply it next frame
+	FRotator ControlRotation = Controller->GetControlRotation();
+	ControlRotation.Yaw = FRotator::NormalizeAxis(ControlRotation.Yaw + LookDelta.X * YawScale);
+	ControlRotation.Pitch = FMath::Clamp(FRotator::NormalizeAxis(ControlRotation.Pitch + LookDelta.Y * PitchScale), PitchAngleMin, PitchAngleMax);
+	Controller->SetControlRotation(ControlRotation);
+	FaceRotation(ControlRotation, DeltaTime);
+}
+
+void APlayerBase::RecordInputEvent(EPlayerInputAction Action, bool bPressed)
+{
+	const double Now = FPlatformTime::Seconds();
+	InputBuffer.Record(Action, bPressed, Now);
+}
+
+bool APlayerBase::ConsumeBufferedPress(EPlayerInputAction Action, float BufferWindow)
+{
+	double PressTimestamp = 0.0;
+	if (!InputBuffer.ConsumePress(Action, FPlatformTime::Seconds(), BufferWindow, PressTimestamp))
+		return false;
+
+	// Let the movement component know how long ago the press that caused this move happened
+	GetCustomCharacterMovement()->SetPendingInputTimestamp(PressTimestamp);
+	return true;
 }
 #pragma endregion
 
@@ -385,6 +883,13 @@ void APlayerBase::UpdateLocomotionState()
 	// Do not run state machine if this actor is not locally controlled
 	if (!IsLocallyControlled())
 		return;
+
+	// Standing or crouching still only changes on movement mode, crouch, input or blocker events,
+	// every other state moves the character each tick and always runs
+	const bool bIdleState = LocomotionState == EPlayerLocomotionState::Idle || LocomotionState == EPlayerLocomotionState::CrouchIdle;
+	if (bIdleState && !HotState.bLocomotionStateDirty && HotState.MoveInput.IsZero())
+		return;
+	HotState.bLocomotionStateDirty = false;
 	
 	switch (LocomotionState)
 	{
@@ -420,14 +925,14 @@ void APlayerBase::UpdateLocomotionState()
 
 void APlayerBase::UpdateLocomotionStateIdle()
 {
-	if (MoveInput.SizeSquared() > 0 && !HasAnyBlocker(EPlayerBlocker::Movement))
+	if (HotState.MoveInput.SizeSquared() > 0 && !HasAnyBlocker(EPlayerBlocker::Movement))
 	{
 		SetLocomotionState(EPlayerLocomotionState::Moving);
 		return;
 	}
 
 	// If we have crouch input and there are no crouch blockers, transition to CrouchIdle
-	if (bCrouchInput && !HasAnyBlocker(EPlayerBlocker::Crouch))
+	if (HotState.InputState.IsHeld(EPlayerInputAction::Crouch) && !HasAnyBlocker(EPlayerBlocker::Crouch))
 	{
 		SetLocomotionState(EPlayerLocomotionState::CrouchIdle);
 		return;
@@ -440,16 +945,16 @@ void APlayerBase::UpdateLocomotionStateIdle()
 		return;
 	}
 
-	if (bJumpInput && !HasAnyBlocker(EPlayerBlocker::Jump))
+	if (!HasAnyBlocker(EPlayerBlocker::Jump) && ConsumeBufferedPress(EPlayerInputAction::Jump, JumpBufferTime))
 		Jump();
 
-	bCurrentLocomotionStateEntered = true;
+	HotState.bCurrentLocomotionStateEntered = true;
 }
 
 void APlayerBase::UpdateLocomotionStateMoving()
 {
 	// If we have no movement input or we have a movement blocker, transition to Idle
-	if (MoveInput.SizeSquared() == 0 || HasAnyBlocker(EPlayerBlocker::Movement))
+	if (HotState.MoveInput.SizeSquared() == 0 || HasAnyBlocker(EPlayerBlocker::Movement))
 	{
 		SetLocomotionState(EPlayerLocomotionState::Idle);
 		return;
@@ -463,41 +968,36 @@ void APlayerBase::UpdateLocomotionStateMoving()
 	}
 
 	// If we have crouch input and there are no crouch blockers, transition to CrouchMoving
-	if (bCrouchInput && !HasAnyBlocker(EPlayerBlocker::Crouch))
+	if (HotState.InputState.IsHeld(EPlayerInputAction::Crouch) && !HasAnyBlocker(EPlayerBlocker::Crouch))
 	{
 		SetLocomotionState(EPlayerLocomotionState::CrouchMoving);
 		return;
 	}
 
 	// If we have sprint input and there are no sprint blockers, transition to Sprinting
-	if (bSprintInput && !HasAnyBlocker(EPlayerBlocker::Sprint))
+	if (HotState.InputState.IsHeld(EPlayerInputAction::Sprint) && !HasAnyBlocker(EPlayerBlocker::Sprint))
 	{
 		SetLocomotionState(EPlayerLocomotionState::Sprinting);
 		return;
 	}
 
-	if (bJumpInput && !HasAnyBlocker(EPlayerBlocker::Jump))
-	{
+	if (!HasAnyBlocker(EPlayerBlocker::Jump) && ConsumeBufferedPress(EPlayerInputAction::Jump, JumpBufferTime))
 		Jump();
-		Server_CheckLedgeGrab();
-	}
 
-	bCurrentLocomotionStateEntered = true;
+	HotState.bCurrentLocomotionStateEntered = true;
 
 	// Handle movement
-	GetCharacterMovement()->MaxWalkSpeed = GetModifiedMoveSpeed(DefaultWalkSpeed);
 	Move();
 }
 
 void APlayerBase::UpdateLocomotionStateSprinting()
 {
 	// If we have no movement input, we have a movement blocker, or we have a sprint blocker, transition to Idle
-	if (MoveInput.SizeSquared() == 0 ||
+	if (HotState.MoveInput.SizeSquared() == 0 ||
 		HasAnyBlocker(EPlayerBlocker::Movement) || 
 		HasAnyBlocker(EPlayerBlocker::Sprint))
 	{
 		SetLocomotionState(EPlayerLocomotionState::Idle);
-		if (!HasAuthority()) Server_SetWalkSpeed(GetModifiedMoveSpeed(DefaultWalkSpeed));
 		return;
 	}
 
@@ -505,44 +1005,39 @@ void APlayerBase::UpdateLocomotionStateSprinting()
 	if (GetCharacterMovement()->IsFalling())
 	{
 		SetLocomotionState(EPlayerLocomotionState::Falling);
-		if (!HasAuthority()) Server_SetWalkSpeed(GetModifiedMoveSpeed(DefaultWalkSpeed));
 		return;
 	}
 
 	// If we have no sprint input or there are sprint blockers, transition to Moving
-	if (!bSprintInput || HasAnyBlocker(EPlayerBlocker::Sprint))
+	if (!HotState.InputState.IsHeld(EPlayerInputAction::Sprint) || HasAnyBlocker(EPlayerBlocker::Sprint))
 	{
 		SetLocomotionState(EPlayerLocomotionState::Moving);
-		if (!HasAuthority()) Server_SetWalkSpeed(GetModifiedMoveSpeed(DefaultWalkSpeed));
 		return;
 	}
 
 	// If we have crouch input and there are no slide blockers or crouch blockers, transition to Sliding
-	if (bCrouchInput && 
+	if (HotState.InputState.IsHeld(EPlayerInputAction::Crouch) && 
 		!HasAnyBlocker(EPlayerBlocker::Slide) && 
 		!HasAnyBlocker(EPlayerBlocker::Crouch))
 	{
 		SetLocomotionState(EPlayerLocomotionState::Sliding);
-		if (!HasAuthority()) Server_SetWalkSpeed(GetModifiedMoveSpeed(DefaultWalkSpeed));
 		return;
 	}
 
-	if (!bCurrentLocomotionStateEntered && !HasAuthority()) Server_SetWalkSpeed(GetModifiedMoveSpeed(DefaultWalkSpeed) * SprintSpeedMultiplier);
-
-	bCurrentLocomotionStateEntered = true;
+	HotState.bCurrentLocomotionStateEntered = true;
 
-	if (bJumpInput && !HasAnyBlocker(EPlayerBlocker::Jump))
+	if (!HasAnyBlocker(EPlayerBlocker::Jump) && ConsumeBufferedPress(EPlayerInputAction::Jump, JumpBufferTime))
 		Jump();
 	
-	// Handle movement
-	GetCharacterMovement()->MaxWalkSpeed = GetModifiedMoveSpeed(DefaultWalkSpeed) * SprintSpeedMultiplier;
+	// Handle movement, the sprint flag goes out with every move so the server runs at the same speed
+	GetCustomCharacterMovement()->SetWantsToSprint(true);
 	Move();
 }
 
 void APlayerBase::UpdateLocomotionStateCrouchIdle()
 {
 	// If we have no crouch input or there are crouch blockers, transition to Idle
-	if ((!bCrouchInput || HasAnyBlocker(EPlayerBlocker::Crouch)) && !GetCharacterMovement()->IsCrouching())
+	if ((!HotState.InputState.IsHeld(EPlayerInputAction::Crouch) || HasAnyBlocker(EPlayerBlocker::Crouch)) && !GetCharacterMovement()->IsCrouching())
 	{
 		SetLocomotionState(EPlayerLocomotionState::Idle);
 		return;
@@ -556,18 +1051,15 @@ void APlayerBase::UpdateLocomotionStateCrouchIdle()
 	}
 
 	// If we have movement input and there are no movement blockers, transition to CrouchMoving
-	if (MoveInput.SizeSquared() > 0 && !HasAnyBlocker(EPlayerBlocker::Movement))
+	if (HotState.MoveInput.SizeSquared() > 0 && !HasAnyBlocker(EPlayerBlocker::Movement))
 	{
 		SetLocomotionState(EPlayerLocomotionState::CrouchMoving);
 		return;
 	}
 
-	bCurrentLocomotionStateEntered = true;
+	HotState.bCurrentLocomotionStateEntered = true;
 
-	if (bCrouchInput)
-		Crouch();
-	else
-		UnCrouch();
+	UpdateCrouch(HotState.InputState.IsHeld(EPlayerInputAction::Crouch));
 }
 
 void APlayerBase::UpdateLocomotionStateCrouchMoving()
@@ -576,7 +1068,7 @@ void APlayerBase::UpdateLocomotionStateCrouchMoving()
 	// or we have a movement blocker and a crouch blocker, 
 	// and on top of those things the character movement component is not crouching, 
 	// transition to Idle
-	bool bMoveOrCrouchInput = MoveInput.SizeSquared() > 0 || bCrouchInput;
+	bool bMoveOrCrouchInput = HotState.MoveInput.SizeSquared() > 0 || HotState.InputState.IsHeld(EPlayerInputAction::Crouch);
 	bool bHasBlockers = HasAnyBlocker(EPlayerBlocker::Movement) && HasAnyBlocker(EPlayerBlocker::Crouch);
 	bool bIsCrouching = GetCharacterMovement()->IsCrouching();
 	if ((!bMoveOrCrouchInput || bHasBlockers) && !bIsCrouching)
@@ -593,7 +1085,7 @@ void APlayerBase::UpdateLocomotionStateCrouchMoving()
 	}
 
 	// If we have no movement input or we have a movement blocker, transition to CrouchIdle
-	if (MoveInput.SizeSquared() == 0 || HasAnyBlocker(EPlayerBlocker::Movement))
+	if (HotState.MoveInput.SizeSquared() == 0 || HasAnyBlocker(EPlayerBlocker::Movement))
 	{
 		SetLocomotionState(EPlayerLocomotionState::CrouchIdle);
 		return;
@@ -602,20 +1094,16 @@ void APlayerBase::UpdateLocomotionStateCrouchMoving()
 	// If we have no crouch input or there are crouch blockers, 
 	// and the character movement component is not crouching, 
 	// transition to Moving
-	if ((!bCrouchInput || HasAnyBlocker(EPlayerBlocker::Crouch)) && !GetCharacterMovement()->IsCrouching())
+	if ((!HotState.InputState.IsHeld(EPlayerInputAction::Crouch) || HasAnyBlocker(EPlayerBlocker::Crouch)) && !GetCharacterMovement()->IsCrouching())
 	{
 		SetLocomotionState(EPlayerLocomotionState::Moving);
 		return;
 	}
 
-	bCurrentLocomotionStateEntered = true;
+	HotState.bCurrentLocomotionStateEntered = true;
 
 	// Handle movement
-	if (bCrouchInput)
-		Crouch();
-	else
-		UnCrouch();
-	GetCharacterMovement()->MaxWalkSpeedCrouched = GetModifiedMoveSpeed(DefaultCrouchSpeed);
+	UpdateCrouch(HotState.InputState.IsHeld(EPlayerInputAction::Crouch));
 	Move();
 }
 
@@ -625,7 +1113,7 @@ void APlayerBase::UpdateLocomotionStateSliding()
 	// or we have a movement blocker and a crouch blocker, 
 	// and on top of those things the character movement component is not crouching, 
 	// transition to Idle
-	bool bMoveOrCrouchInput = MoveInput.SizeSquared() > 0 || bCrouchInput;
+	bool bMoveOrCrouchInput = HotState.MoveInput.SizeSquared() > 0 || HotState.InputState.IsHeld(EPlayerInputAction::Crouch);
 	bool bHasBlockers = HasAnyBlocker(EPlayerBlocker::Movement) && HasAnyBlocker(EPlayerBlocker::Crouch);
 	bool bIsCrouching = GetCharacterMovement()->IsCrouching();
 	if ((!bMoveOrCrouchInput || bHasBlockers) && !bIsCrouching)
@@ -642,32 +1130,38 @@ void APlayerBase::UpdateLocomotionStateSliding()
 	}
 
 	// If we have no sprint input or there are crouch blockers, transition to CrouchMoving
-	// TODO: Potential bug on leaving slide
-	if (!bSprintInput || HasAnyBlocker(EPlayerBlocker::Crouch))
+	if (!HotState.InputState.IsHeld(EPlayerInputAction::Sprint) || HasAnyBlocker(EPlayerBlocker::Crouch))
 	{
 		SetLocomotionState(EPlayerLocomotionState::CrouchMoving);
 		return;
 	}
 
 	// If we have no movement input or we have a movement blocker, transition to CrouchIdle
-	if (MoveInput.SizeSquared() == 0 || HasAnyBlocker(EPlayerBlocker::Movement))
+	if (HotState.MoveInput.SizeSquared() == 0 || HasAnyBlocker(EPlayerBlocker::Movement))
 	{
 		SetLocomotionState(EPlayerLocomotionState::CrouchIdle);
 		return;
 	}
 
 	// If no crouch input or there are crouch blockers, transition to Moving
-	if ((!bCrouchInput || HasAnyBlocker(EPlayerBlocker::Crouch)) && !GetCharacterMovement()->IsCrouching())
+	if ((!HotState.InputState.IsHeld(EPlayerInputAction::Crouch) || HasAnyBlocker(EPlayerBlocker::Crouch)) && !GetCharacterMovement()->IsCrouching())
 	{
 		SetLocomotionState(EPlayerLocomotionState::Moving);
 		return;
 	}
+
+	// If the slide never started or has run out of speed, transition to CrouchMoving
+	if (HotState.bCurrentLocomotionStateEntered && !GetCustomCharacterMovement()->IsSliding())
+	{
+		SetLocomotionState(EPlayerLocomotionState::CrouchMoving);
+		return;
+	}
 	
-	bCurrentLocomotionStateEntered = true;
+	HotState.bCurrentLocomotionStateEntered = true;
 
-	// Handle movement
-	Crouch();
-	GetCharacterMovement()->MaxWalkSpeedCrouched = GetModifiedMoveSpeed(DefaultCrouchSpeed);
+	// Handle movement, the movement component runs the slide itself so it is predicted with every move
+	UpdateCrouch(true);
+	GetCustomCharacterMovement()->SetWantsToSlide(true);
 	Move();
 }
 
@@ -676,51 +1170,55 @@ void APlayerBase::UpdateLocomotionStateFalling()
 	// If we are no longer falling, transition to Idle
 	if (!GetCharacterMovement()->IsFalling())
 	{
-		bClientLedgeGrabCheckSucceeded = false;
+		HotState.bClientLedgeGrabCheckSucceeded = false;
 		LedgeGrabLedgeTransform = FTransform();
 		SetLocomotionState(EPlayerLocomotionState::Idle);
 		return;
 	}
 
-	if (!bCurrentLocomotionStateEntered)
+	if (!HotState.bCurrentLocomotionStateEntered)
 	{
-		bClientLedgeGrabCheckSucceeded = false;
+		HotState.bClientLedgeGrabCheckSucceeded = false;
 		bServerLedgeGrabCheckSucceeded = false;
 		LedgeGrabLedgeTransform = FTransform();
 		LedgeGrabCapsuleDestination = FTransform();
 	}
+
+	// Coyote time, CanJump only allows this shortly after walking off a ledge
+	if (!HasAnyBlocker(EPlayerBlocker::Jump) && CanJump() && ConsumeBufferedPress(EPlayerInputAction::Jump, JumpBufferTime))
+		Jump();
 	
-	if (bJumpInput)
+	if (HotState.InputState.IsHeld(EPlayerInputAction::Jump))
 	{
-		// TODO: Continue here
-		// Assume server ledge grab check succeeded if standalone
-		if (IsNetMode(NM_Standalone))
+		if (HasAuthority())
 		{
-			bServerLedgeGrabCheckSucceeded = true;
-			bClientLedgeGrabCheckSucceeded = CheckLedgeGrab(LedgeGrabLedgeTransform);
+			// Standalone and listen server hosts are the authority on their own ledge grabs
+			HotState.bClientLedgeGrabCheckSucceeded = CheckLedgeGrab(GetActorTransform(), LedgeGrabLedgeTransform);
+			bServerLedgeGrabCheckSucceeded = HotState.bClientLedgeGrabCheckSucceeded;
 		}
-		bServerLedgeGrabCheckSucceeded = true;
-		bool bLedgeGrabAgreed = bClientLedgeGrabCheckSucceeded && bServerLedgeGrabCheckSucceeded;
-		
+		else if (!HotState.bClientLedgeGrabCheckSucceeded || (!bServerLedgeGrabCheckSucceeded && GetWorld()->GetTimeSeconds() - HotState.LedgeGrabCheckRequestTime > GetLedgeGrabCheckRetryDelay()))
+		{
+			// Ask the server to confirm once we find a ledge, the result replicates back through bServerLedgeGrabCheckSucceeded.
+			// Only success replicates, so a lost request and a rejection look the same, check again and resend until the fall ends
+			HotState.bClientLedgeGrabCheckSucceeded = CheckLedgeGrab(GetActorTransform(), LedgeGrabLedgeTransform);
+			if (HotState.bClientLedgeGrabCheckSucceeded)
+			{
+				Server_CheckLedgeGrab(GetCharacterMovement()->GetPredictionData_Client_Character()->CurrentTimeStamp);
+				HotState.LedgeGrabCheckRequestTime = GetWorld()->GetTimeSeconds();
+			}
+		}
+
+		bool bLedgeGrabAgreed = HotState.bClientLedgeGrabCheckSucceeded && bServerLedgeGrabCheckSucceeded;
 		if (bLedgeGrabAgreed)
 		{
 			SetLocomotionState(EPlayerLocomotionState::LedgeGrabbing);
 			return;
 		}
-		else if (!HasAuthority())
-		{
-			bClientLedgeGrabCheckSucceeded = CheckLedgeGrab(LedgeGrabLedgeTransform);
-			if (bClientLedgeGrabCheckSucceeded)
-			{
-				Server_CheckLedgeGrab();
-			}
-		}
 	}
 	
-	bCurrentLocomotionStateEntered = true;
+	HotState.bCurrentLocomotionStateEntered = true;
 
 	// Handle movement
-	GetCharacterMovement()->MaxWalkSpeed = GetModifiedMoveSpeed(DefaultWalkSpeed);
 	Move();
 }
 
@@ -737,7 +1235,7 @@ void APlayerBase::UpdateLocomotionStateLedgeGrabbing()
 	}
 
 	// Set up ledge grab
-	if (!bCurrentLocomotionStateEntered)
+	if (!HotState.bCurrentLocomotionStateEntered)
 	{
 		if (!HasAuthority() && IsNetMode(NM_Client))
 			Server_PrepareForLedgeGrab();
@@ -745,7 +1243,7 @@ void APlayerBase::UpdateLocomotionStateLedgeGrabbing()
 	}
 
 	// If the ledge grab is completed, transition to idle
-	if (LedgeGrabProgress >= 1.0f)
+	if (HotState.LedgeGrabProgress >= 1.0f)
 	{
 		if (!HasAuthority() && IsNetMode(NM_Client))
 			Server_CleanUpLedgeGrab();
@@ -754,12 +1252,12 @@ void APlayerBase::UpdateLocomotionStateLedgeGrabbing()
 		return;
 	}
 	
-	bCurrentLocomotionStateEntered = true;
+	HotState.bCurrentLocomotionStateEntered = true;
 	
 	// Perform Ledge Grab
 	if (!IsValid(LedgeGrabMovementCurve)) return;
 	
-	FVector CurveSample = LedgeGrabMovementCurve->GetVectorValue(LedgeGrabProgress);
+	FVector CurveSample = LedgeGrabMovementCurve->GetVectorValue(HotState.LedgeGrabProgress);
 	FVector NewLocation = FVector::ZeroVector;
 	NewLocation.X = FMath::Lerp(LedgeGrabStartTransform.GetLocation().X, LedgeGrabCapsuleDestination.GetLocation().X, CurveSample.X);
 	NewLocation.Y = FMath::Lerp(LedgeGrabStartTransform.GetLocation().Y, LedgeGrabCapsuleDestination.GetLocation().Y, CurveSample.Y);
@@ -769,122 +1267,228 @@ void APlayerBase::UpdateLocomotionStateLedgeGrabbing()
 	AddMovementInput(DeltaMovement, Scale);
 
 	// Increment LedgeGrabProgress progress
-	LedgeGrabProgress += UGameplayStatics::GetWorldDeltaSeconds(this) * (1 / FMath::Max(0.0001f, LedgeGrabSpeed));
-	LedgeGrabProgress = FMath::Clamp(LedgeGrabProgress, 0.0f, 1.0f);
+	HotState.LedgeGrabProgress += UGameplayStatics::GetWorldDeltaSeconds(this) * (1 / FMath::Max(0.0001f, LedgeGrabSpeed));
+	HotState.LedgeGrabProgress = FMath::Clamp(HotState.LedgeGrabProgress, 0.0f, 1.0f);
 }
 
 void APlayerBase::SetLocomotionState(EPlayerLocomotionState NewState, bool bBroadcast)
 {
 	if (bBroadcast)
-		OnLocomotionStateChanged.Broadcast(LocomotionState, NewState, this);
+		BroadcastLocomotionStateChanged(LocomotionState, NewState);
+
+	// Time in each state on the server, what the correction log's per-state correction rates are measured against
+	if (HasAuthority() && GetWorld() && FMovementCorrectionLog::Get().IsOpen())
+	{
+		FMovementCorrectionRecord Record;
+		Record.Type = EMovementCorrectionRecordType::StateTime;
+		Record.Time = GetWorld()->GetTimeSeconds();
+		Record.Duration = Record.Time - LocomotionStateStartTime;
+		Record.Location = FVector3f(GetActorLocation());
+		FillCorrectionRecord(Record);
+		FMovementCorrectionLog::Get().Push(Record);
+	}
+
+	// Whichever state comes next, the movement component should stop sliding
+	if (LocomotionState == EPlayerLocomotionState::Sliding && NewState != EPlayerLocomotionState::Sliding)
+		GetCustomCharacterMovement()->SetWantsToSlide(false);
+	if (LocomotionState == EPlayerLocomotionState::Sprinting && NewState != EPlayerLocomotionState::Sprinting)
+		GetCustomCharacterMovement()->SetWantsToSprint(false);
+
 	LocomotionState = NewState;
-	bCurrentLocomotionStateEntered = false;
+	LocomotionStateStartTime = GetWorld() ? GetWorld()->GetTimeSeconds() : 0.0f;
+	HotState.bCurrentLocomotionStateEntered = false;
+	MarkLocomotionStateDirty();
+
+	// The state machine only runs on the owning client, its moves carry the state to the server to replicate to everyone else
+	if (IsLocallyControlled())
+		GetCustomCharacterMovement()->SetLocomotionState(NewState);
+}
+
+void APlayerBase::ApplyClientLocomotionState(EPlayerLocomotionState NewState)
+{
+	// Every move carries the state, only a different one is a transition
+	if (NewState != LocomotionState)
+		SetLocomotionState(NewState);
+}
+
+void APlayerBase::BroadcastLocomotionStateChanged(EPlayerLocomotionState PreviousState, EPlayerLocomotionState NewState)
+{
+	PushLocomotionEvent(EPlayerLocomotionEventType::StateExit, PreviousState);
+	PushLocomotionEvent(EPlayerLocomotionEventType::StateEnter, NewState);
+
+	// Skip the reflected call entirely when no Blueprint is listening
+	if (OnLocomotionStateChanged.IsBound())
+		OnLocomotionStateChanged.Broadcast(PreviousState, NewState, this);
+}
+
+void APlayerBase::PushLocomotionEvent(EPlayerLocomotionEventType Type, EPlayerLocomotionState State)
+{
+	// Not there yet for the state set in the constructor
+	if (LocomotionEvents)
+		LocomotionEvents->Push(Type, State, this);
 }
 
 void APlayerBase::Move()
 {
-	FVector2D MoveDirection = MoveInput;
+	FVector2D MoveDirection = HotState.MoveInput;
 	MoveDirection.Normalize();
 
 	AddMovementInput(GetActorForwardVector(), MoveDirection.Y);
 	AddMovementInput(GetActorRightVector(), MoveDirection.X);
 }
 
-float APlayerBase::GetModifiedMoveSpeed(float StartingMoveSpeed)
+float APlayerBase::GetLedgeGrabCheckRetryDelay() const
+{
+	const APlayerState* State = GetPlayerState();
+	const float RoundTripTime = State ? State->GetPingInMilliseconds() * 0.001f : 0.0f;
+	return LedgeGrabCheckRetryTime + RoundTripTime;
+}
+
+float APlayerBase::GetMoveSpeedModifierProduct() const
 {
-	float ModifiedMoveSpeed = StartingMoveSpeed;
-	for (TPair<FString, float>& Pair : MoveSpeedModifiers)
+	float Product = 1.0f;
+	for (const TPair<FName, float>& Pair : MoveSpeedModifiers)
 	{
-		ModifiedMoveSpeed *= Pair.Value;
+		Product *= Pair.Value;
 	}
-	return ModifiedMoveSpeed;
+	return Product;
 }
 
 FVector APlayerBase::GetCrouchPositionRelativeCameraBoomPosition()
 {
 	if (!IsValid(CrouchSpeedCurve)) return FVector::ZeroVector;
 	
-	float Value = CrouchSpeedCurve->GetFloatValue(CrouchCameraLerpProgress);
-	FVector TopPosition;
-	FVector BottomPosition;
+	float Value = CrouchSpeedCurve->GetFloatValue(HotState.CrouchCameraLerpProgress);
+	return FVector(0, 0, FMath::Lerp(HotState.CrouchCameraTopZ, HotState.CrouchCameraBottomZ, Value));
+}
+
+void APlayerBase::UpdateCrouch(bool bWantsCrouch)
+{
+	UCharacterMovementComponent* Movement = GetCharacterMovement();
+
+	// Crouching and standing up are only requested on a change, the movement component resizes the capsule once per request
+	if (bWantsCrouch)
+	{
+		if (!Movement->bWantsToCrouch)
+			Crouch();
+		return;
+	}
+
+	if (!Movement->IsCrouching())
+		return;
+
+	// A blocked UnCrouch is retried with an encroachment check every tick,
+	// so if the last one failed keep crouching and wait for the ceiling probe to find room
+	if (!Movement->bWantsToCrouch)
+	{
+		HotState.bCanUnCrouch = false;
+		MarkLocomotionStateDirty();
+		Crouch();
+		return;
+	}
 
-	if (GetCharacterMovement()->IsCrouching())
+	// Keep re-evaluating until we are standing, CrouchIdle would otherwise stop updating
+	MarkLocomotionStateDirty();
+	RequestCeilingProbe();
+	if (HotState.bCanUnCrouch)
+		UnCrouch();
+}
+
+void APlayerBase::RequestCeilingProbe()
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+	if (CeilingProbeHandle.IsValid() || Now - LastCeilingProbeTime < CeilingProbeInterval)
+		return;
+
+	// Standing capsule with its base where the crouched capsule's base is
+	const FVector StandingLocation = GetActorLocation() + GetActorUpVector() * Defaults.CrouchCapsuleResizeOffset;
+	CeilingProbeHandle = PhysicsProbe.AsyncOverlapPawn(GetWorld(), StandingLocation, GetActorQuat(), CeilingProbeShape, &CeilingProbeDelegate);
+	LastCeilingProbeTime = Now;
+}
+
+void APlayerBase::OnCeilingProbeComplete(const FTraceHandle& TraceHandle, FOverlapDatum& OverlapDatum)
+{
+	if (!(TraceHandle == CeilingProbeHandle))
+		return;
+
+	CeilingProbeHandle = FTraceHandle();
+	HotState.bCanUnCrouch = !OverlapDatum.OutOverlaps.ContainsByPredicate([](const FOverlapResult& Overlap) { return Overlap.bBlockingHit; });
+}
+
+void APlayerBase::SetCrouchCameraEndpoints(bool bCrouched)
+{
+	// The boom is attached to the capsule, so both endpoints shift with it when the capsule resizes
+	if (bCrouched)
 	{
-		TopPosition = {0, 0, CrouchCapsuleResizeOffset + DefaultCameraBoomZ};
-		BottomPosition = {0, 0, CameraBoomCrouchedZ};
+		HotState.CrouchCameraTopZ = Defaults.CrouchCapsuleResizeOffset + Defaults.CameraBoomZ;
+		HotState.CrouchCameraBottomZ = CameraBoomCrouchedZ;
 	}
 	else
 	{
-		TopPosition = {0, 0, DefaultCameraBoomZ};
-		BottomPosition = {0, 0, -CrouchCapsuleResizeOffset + CameraBoomCrouchedZ};
+		HotState.CrouchCameraTopZ = Defaults.CameraBoomZ;
+		HotState.CrouchCameraBottomZ = -Defaults.CrouchCapsuleResizeOffset + CameraBoomCrouchedZ;
 	}
-	
-	return FMath::Lerp(TopPosition, BottomPosition, Value);
 }
 
-bool APlayerBase::CheckLedgeGrab(FTransform& OutLedgeTransform)
+void APlayerBase::UpdateCameraBoomLocation()
+{
+	if (CameraBoom && !bCosmeticComponentsDormant)
+		CameraBoom->SetRelativeLocation(GetCrouchPositionRelativeCameraBoomPosition());
+}
+
+void APlayerBase::UpdateCrouchCamera(float DeltaTime)
+{
+	// Nothing to do once the camera has settled at the end of a transition
+	const float TargetProgress = GetCharacterMovement()->IsCrouching() ? 1.0f : 0.0f;
+	if (HotState.CrouchCameraLerpProgress == TargetProgress)
+		return;
+
+	const float LerpStep = DeltaTime / FMath::Max(CrouchSpeed, 0.0001f);
+	HotState.CrouchCameraLerpProgress = FMath::Clamp(HotState.CrouchCameraLerpProgress + (TargetProgress > 0.0f ? LerpStep : -LerpStep), 0.0f, 1.0f);
+	UpdateCameraBoomLocation();
+}
+
+bool APlayerBase::CheckLedgeGrab(const FTransform& ActorTransform, FTransform& OutLedgeTransform)
 {
 	bool bDebug = false;
 	FColor Color = HasAuthority() ? FColor::Red : FColor::Blue;
-	EDrawDebugTrace::Type DebugTraceType = bDebug ? EDrawDebugTrace::ForDuration : EDrawDebugTrace::None;
 	float Duration = HasAuthority() ? 5 : 2;
+	const FQuat ActorQuat = ActorTransform.GetRotation();
 	
 	// BoxTrace Down
 	FHitResult Hit;
-	TArray<AActor*> ActorsToIgnore;
-	ActorsToIgnore.Add(this);
-	UKismetSystemLibrary::BoxTraceSingleByProfile(
-		GetWorld(),
-		GetActorTransform().TransformPosition(LedgeGrabTraceStart),
-		GetActorTransform().TransformPosition(LedgeGrabTraceEnd),
-		FVector(LedgeGrabTraceSize / 2),
-		GetActorRotation(),
-		UEnum::GetValueAsName(ECC_Visibility),
-		true,
-		ActorsToIgnore,
-		DebugTraceType,
-		Hit,
-		true,
-		Color,
-		FLinearColor::Green,
-		Duration);
+	const FVector TraceStart = ActorTransform.TransformPosition(LedgeGrabTraceStart);
+	const FVector TraceEnd = ActorTransform.TransformPosition(LedgeGrabTraceEnd);
+	PhysicsProbe.Sweep(GetWorld(), TraceStart, TraceEnd, ActorQuat, LedgeGrabTraceShape, Hit);
+
+	if (bDebug)
+		DrawDebugSweptBox(GetWorld(), TraceStart, TraceEnd, ActorQuat.Rotator(), LedgeGrabTraceShape.GetExtent(), Hit.bBlockingHit ? FColor::Green : Color, false, Duration);
 
 	// Return if we did not hit a valid actor
 	if (!(Hit.bBlockingHit && IsValid(Hit.GetActor()))) return false;
 	
 	// Return if the floor is not a walkable angle
-	float LedgeAngle = abs(acos(GetActorUpVector().Dot(Hit.ImpactNormal)));
+	float LedgeAngle = abs(acos(ActorQuat.GetUpVector().Dot(Hit.ImpactNormal)));
 	if (LedgeAngle >= GetCharacterMovement()->GetWalkableFloorAngle()) return false;
 
 	// Cache initial hit location
 	FVector InitialHitLocation = Hit.ImpactPoint;
 
 	// Get oriented height of InitialHitLocation;
-	FVector TransformedInitialHitLocation = GetActorTransform().InverseTransformPositionNoScale(InitialHitLocation);
+	FVector TransformedInitialHitLocation = ActorTransform.InverseTransformPositionNoScale(InitialHitLocation);
 	FVector InitialHitOffset = FVector(0, 0, TransformedInitialHitLocation.Z);
-	FVector FollowUpTraceStart = GetActorTransform().TransformPosition(InitialHitOffset);
+	FVector FollowUpTraceStart = ActorTransform.TransformPosition(InitialHitOffset);
 	
 	// BoxTrace from player at height of initial hit
-	UKismetSystemLibrary::BoxTraceSingleByProfile(
-	GetWorld(),
-	FollowUpTraceStart,
-	InitialHitLocation,
-	FVector(LedgeGrabTraceSize / 2),
-	GetActorRotation(),
-	UEnum::GetValueAsName(ECC_Visibility),
-	true,
-	ActorsToIgnore,
-	DebugTraceType,
-	Hit,
-	true,
-	Color,
-	FLinearColor::Green,
-	Duration);
+	PhysicsProbe.Sweep(GetWorld(), FollowUpTraceStart, InitialHitLocation, ActorQuat, LedgeGrabTraceShape, Hit);
+
+	if (bDebug)
+		DrawDebugSweptBox(GetWorld(), FollowUpTraceStart, InitialHitLocation, ActorQuat.Rotator(), LedgeGrabTraceShape.GetExtent(), Hit.bBlockingHit ? FColor::Green : Color, false, Duration);
 	
 	// Calculate ledge location
-	FVector TransformedFollowUpHitLocation = GetActorTransform().InverseTransformPositionNoScale(Hit.ImpactPoint);
+	FVector TransformedFollowUpHitLocation = ActorTransform.InverseTransformPositionNoScale(Hit.ImpactPoint);
 	FVector FollowUpHitOffset = FVector(TransformedFollowUpHitLocation.X, TransformedFollowUpHitLocation.Y, TransformedInitialHitLocation.Z);
-	FVector FollowUpHitPosition = GetActorTransform().TransformPosition(FollowUpHitOffset);
+	FVector FollowUpHitPosition = ActorTransform.TransformPosition(FollowUpHitOffset);
 
 	// Set OutLedgeTransform
 	FTransform LedgeTransform;
@@ -909,22 +1513,8 @@ bool APlayerBase::CheckLedgeGrab(FTransform& OutLedgeTransform)
 			5);
 	}
 	
-	// Capsule Overlap at destination
-	TArray<TEnumAsByte<EObjectTypeQuery>> ObjectTypes;
-	ObjectTypes.Add(TEnumAsByte<EObjectTypeQuery>(ECC_WorldStatic));
-	TArray<AActor*> OverlappedActors;
-	UKismetSystemLibrary::CapsuleOverlapActors(
-		GetWorld(),
-		CapsuleDestination,
-		GetCapsuleComponent()->GetUnscaledCapsuleRadius(),
-		GetCapsuleComponent()->GetUnscaledCapsuleHalfHeight(),
-		ObjectTypes,
-		AActor::StaticClass(),
-		ActorsToIgnore,
-		OverlappedActors);
-
 	// Return if overlapped any WorldStatic objects at destination
-	if (!OverlappedActors.IsEmpty()) return false;
+	if (PhysicsProbe.OverlapAnyStatic(GetWorld(), CapsuleDestination, FQuat::Identity, LedgeGrabDestinationShape)) return false;
 
 	OutLedgeTransform = LedgeTransform;
 	LedgeGrabCapsuleDestination.SetLocation(CapsuleDestination);
@@ -953,21 +1543,46 @@ bool APlayerBase::CheckLedgeGrab(FTransform& OutLedgeTransform)
 	return true;
 }
 
+double APlayerBase::GetServerTimeForClientTimeStamp(float ClientTimeStamp) const
+{
+	// Client move timestamps advance with time, so the server simulated the move at ClientTimeStamp
+	// as long ago as the client has moved on since. Newer or reset timestamps mean now
+	const FNetworkPredictionData_Server_Character* ServerData = GetCharacterMovement()->GetPredictionData_Server_Character();
+	const float TimeSinceTimeStamp = ServerData ? FMath::Clamp(ServerData->CurrentClientTimeStamp - ClientTimeStamp, 0.0f, ULagCompensationSubsystem::MaxRewindTime) : 0.0f;
+	return GetWorld()->GetTimeSeconds() - TimeSinceTimeStamp;
+}
+
+float APlayerBase::GetClientViewRewindTime() const
+{
+	// Prefer the connection's measured lag, the player state's ping is only updated now and then
+	float RoundTripTime = 0.0f;
+	if (const UNetConnection* Connection = GetNetConnection())
+		RoundTripTime = Connection->AvgLag;
+	else if (const APlayerState* State = GetPlayerState())
+		RoundTripTime = State->GetPingInMilliseconds() * 0.001f;
+
+	// Other characters are smoothed towards their replicated positions over about this long
+	const float InterpolationDelay = GetCharacterMovement()->NetworkSimulatedSmoothLocationTime;
+	return ULagCompensationSubsystem::GetViewRewindTime(RoundTripTime, InterpolationDelay);
+}
+
 void APlayerBase::PrepareForLedgeGrab()
 {
-	LedgeGrabProgress = 0.0f;
+	HotState.LedgeGrabProgress = 0.0f;
 	LedgeGrabStartTransform = GetActorTransform();
 	MovementModeBeforeLedgeGrab = GetCharacterMovement()->MovementMode;
-	bIsLedgeGrabbing = true;
+	HotState.bIsLedgeGrabbing = true;
 	
 	StopJumping();
 	GetCharacterMovement()->Velocity = FVector::Zero();
-	GetCharacterMovement()->SetMovementMode(MOVE_Custom);
+	GetCustomCharacterMovement()->SetLedgeGrabCorridorClear(true);
+	GetCharacterMovement()->SetMovementMode(MOVE_Custom, CMOVE_LedgeGrab);
 	FRotator NewRotation = LedgeGrabCapsuleDestination.GetRotation().Rotator();
 	NewRotation.Yaw += 180;
 	UGameplayStatics::GetPlayerController(this, 0)->SetControlRotation(NewRotation);
 	GetCapsuleComponent()->SetCollisionResponseToChannel(ECC_WorldStatic, ECR_Ignore);
-	AddBlocker(EPlayerBlocker::Look, "LedgeGrab");
+	LedgeGrabBlockers = AcquireBlockers(PlayerBlockers::GetBit(EPlayerBlocker::Look));
+	PushLocomotionEvent(EPlayerLocomotionEventType::LedgeGrabStart, LocomotionState);
 }
 
 void APlayerBase::CleanUpLedgeGrab()
@@ -975,7 +1590,73 @@ void APlayerBase::CleanUpLedgeGrab()
 	GetCapsuleComponent()->SetCollisionResponseToChannel(ECC_WorldStatic, ECR_Block);
 	GetCharacterMovement()->Velocity = FVector::Zero();
 	GetCharacterMovement()->SetMovementMode(MovementModeBeforeLedgeGrab);
-	RemoveBlocker(EPlayerBlocker::Look, "LedgeGrab");
-	bIsLedgeGrabbing = false;
+	LedgeGrabBlockers.Release();
+	HotState.bIsLedgeGrabbing = false;
+	PushLocomotionEvent(EPlayerLocomotionEventType::LedgeGrabEnd, LocomotionState);
+
+	// Reset so the next successful check replicates as a change
+	if (HasAuthority())
+		bServerLedgeGrabCheckSucceeded = false;
 }
-#pragma endregion
\ No newline at end of file
+#pragma endregion
+
+void APlayerBase::TestLedgeGrabAllocations(int32 Iterations)
+{
+	if (!FTraceAuxiliary::IsConnected())
+	{
+		UE_LOG(LogPlayerBase, Warning, TEXT("'%s' No trace is being recorded, run with -trace=default,memalloc"), *GetNameSafe(this));
+		return;
+	}
+
+	// The first query may still initialize engine side state, only steady state checks count
+	FTransform LedgeTransform;
+	const FTransform CapsuleDestination = LedgeGrabCapsuleDestination;
+	CheckLedgeGrab(GetActorTransform(), LedgeTransform);
+
+	// Memory Insights lists the allocations made inside the region, there should be none
+	TRACE_BEGIN_REGION(TEXT("LedgeGrabAllocationTest"));
+	for (int32 i = 0; i < Iterations; i++)
+	{
+		CheckLedgeGrab(GetActorTransform(), LedgeTransform);
+	}
+	TRACE_END_REGION(TEXT("LedgeGrabAllocationTest"));
+	LedgeGrabCapsuleDestination = CapsuleDestination;
+
+	UE_LOG(LogPlayerBase, Display, TEXT("LedgeGrabAllocationTest traced %d checks, see the LedgeGrabAllocationTest region in Memory Insights"), Iterations);
+}
+
+void APlayerBase::BenchmarkLocomotionEvents(int32 Iterations)
+{
+	if (!LocomotionEvents || Iterations <= 0)
+		return;
+
+	// Get real events out of the way so they are not timed
+	LocomotionEvents->Flush();
+
+	// Event bus, a transition is an exit and an enter event dispatched to one empty subscriber each
+	const FDelegateHandle ExitHandle = LocomotionEvents->OnEvent(EPlayerLocomotionEventType::StateExit).AddLambda([](const FPlayerLocomotionEvent&) {});
+	const FDelegateHandle EnterHandle = LocomotionEvents->OnEvent(EPlayerLocomotionEventType::StateEnter).AddLambda([](const FPlayerLocomotionEvent&) {});
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 i = 0; i < Iterations; i++)
+	{
+		LocomotionEvents->Push(EPlayerLocomotionEventType::StateExit, LocomotionState, this);
+		LocomotionEvents->Push(EPlayerLocomotionEventType::StateEnter, LocomotionState, this);
+	}
+	LocomotionEvents->Flush();
+	const double BusMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	LocomotionEvents->OnEvent(EPlayerLocomotionEventType::StateExit).Remove(ExitHandle);
+	LocomotionEvents->OnEvent(EPlayerLocomotionEventType::StateEnter).Remove(EnterHandle);
+
+	// Dynamic delegate with one empty UFUNCTION listener, kept local so bound Blueprints do not fire
+	FOnLocomotionStateChangedSignature DynamicDelegate;
+	DynamicDelegate.AddDynamic(this, &APlayerBase::OnLocomotionStateChangedBenchmark);
+	StartTime = FPlatformTime::Seconds();
+	for (int32 i = 0; i < Iterations; i++)
+	{
+		DynamicDelegate.Broadcast(LocomotionState, LocomotionState, this);
+	}
+	const double DynamicMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	UE_LOG(LogPlayerBase, Display, TEXT("LocomotionEventBenchmark Transitions=%d BusPerMs=%.0f DynamicPerMs=%.0f"),
+		Iterations, Iterations / FMath::Max(BusMs, UE_SMALL_NUMBER), Iterations / FMath::Max(DynamicMs, UE_SMALL_NUMBER));
+}
\ No newline at end of file
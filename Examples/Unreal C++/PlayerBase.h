@@ -5,6 +5,11 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
 #include "Logging/LogMacros.h"
+#include "Containers/StaticArray.h"
+#include "Player/PlayerInputBuffer.h"
+#include "Player/PlayerBlockers.h"
+#include "Player/PlayerPhysicsProbe.h"
+#include "Components/SkinnedMeshComponent.h"
 #include "PlayerBase.generated.h"
 
 class USkeletalMeshComponent;
@@ -14,9 +19,14 @@ class UInputComponent;
 class UInputAction;
 class UInputMappingContext;
 class UCurveFloat;
+class UCustomCharacterMovementComponent;
+class UPlayerLocomotionEventSubsystem;
+class UNetAccountingSubsystem;
 struct FInputActionValue;
 struct FEnhancedInputActionValueBinding;
 struct FTimeline;
+enum class ETriggerEvent : uint8;
+enum class EPlayerLocomotionEventType : uint8;
 
 DECLARE_LOG_CATEGORY_EXTERN(LogPlayerBase, Log, All);
 
@@ -31,24 +41,70 @@ enum class EPlayerLocomotionState : uint8
 	Sliding,
 	LedgeGrabbing,
 	Falling,
+	MAX UMETA(Hidden),
 };
 
-UENUM(BlueprintType)
-enum class EPlayerBlocker : uint8
+// What third person animation needs from a player, copied on the game thread so the rest of the anim update can run on a worker thread
+USTRUCT(BlueprintType)
+struct FPlayerAnimSnapshot
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = Locomotion)
+	EPlayerLocomotionState LocomotionState = EPlayerLocomotionState::Idle;
+
+	// Seconds since LocomotionState was entered, e.g. how far into a slide
+	UPROPERTY(BlueprintReadOnly, Category = Locomotion)
+	float StateTime = 0.0f;
+
+	// 0 to 1 through a ledge grab
+	UPROPERTY(BlueprintReadOnly, Category = Locomotion)
+	float LedgeGrabProgress = 0.0f;
+
+	// 0 standing to 1 crouched
+	UPROPERTY(BlueprintReadOnly, Category = Locomotion)
+	float CrouchBlend = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = Locomotion)
+	FVector Velocity = FVector::ZeroVector;
+};
+
+/**
+ * State APlayerBase reads and writes every tick (input, locomotion state machine and camera smoothing),
+ * kept together so a tick touches a few contiguous cache lines instead of fields spread across the actor.
+ */
+struct FPlayerHotState
+{
+	// Input
+	FVector2D MoveInput = FVector2D::ZeroVector;
+	FVector2D LookInput = FVector2D::ZeroVector;
+	FVector2D PendingLookInput = FVector2D::ZeroVector;
+	FPlayerInputState InputState;
+
+	// Locomotion
+	float LedgeGrabProgress = 0.0f;
+	float LedgeGrabCheckRequestTime = 0.0f;
+	float CrouchCameraLerpProgress = 0.0f;
+	float CrouchCameraTopZ = 0.0f;
+	float CrouchCameraBottomZ = 0.0f;
+	bool bCurrentLocomotionStateEntered = false;
+	bool bLocomotionStateDirty = true;
+	bool bCanUnCrouch = true;
+	bool bIsLedgeGrabbing = false;
+	bool bClientLedgeGrabCheckSucceeded = false;
+};
+
+/**
+ * Values APlayerBase derives from its class defaults (movement speeds, capsule and camera heights).
+ * Built once per class from the class default object, so Blueprint overrides are included, and copied into each instance.
+ */
+struct FPlayerClassDefaults
 {
-	Movement,
-	Look,
-	Sprint,
-	Crouch,
-	Slide,
-	Jump,
-	Interact,
-	ToggleFlashlight,
-	PrimaryFire,
-	SecondaryFire,
-	Reload,
-	AimDownSights,
-	WeaponSwap,
+	float WalkSpeed = 0.0f;
+	float CrouchSpeed = 0.0f;
+	float CapsuleHalfHeight = 0.0f;
+	float CameraBoomZ = 0.0f;
+	float CrouchCapsuleResizeOffset = 0.0f;
 };
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnLocomotionStateChangedSignature, EPlayerLocomotionState, PreviousState, EPlayerLocomotionState, NewState, APlayerBase*, Player);
@@ -70,6 +126,30 @@ public:
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+	virtual bool CallRemoteFunction(UFunction* Function, void* Parameters, FOutParmRec* OutParms, FFrame* Stack) override;
+
+	UCustomCharacterMovementComponent* GetCustomCharacterMovement() const;
+	const FPlayerInputState& GetInputState() const { return HotState.InputState; }
+	EPlayerLocomotionState GetLocomotionState() const { return LocomotionState; }
+	// Server only, the owning client's state as sent with its moves
+	void ApplyClientLocomotionState(EPlayerLocomotionState NewState);
+	// Game thread only
+	FPlayerAnimSnapshot GetAnimSnapshot() const;
+
+	// Puts the pawn back the way it spawned so a pool can hand it out again, see UPlayerPawnPoolSubsystem
+	void ResetForReuse();
+
+	// Adds this player's side of a movement correction, the locomotion state, blockers and speed modifiers
+	void FillCorrectionRecord(struct FMovementCorrectionRecord& Record) const;
+
+	virtual void PostInitializeComponents() override;
+	virtual void Landed(const FHitResult& Hit) override;
+	virtual void OnMovementModeChanged(EMovementMode PrevMovementMode, uint8 PreviousCustomMode = 0) override;
+	virtual void OnJumped_Implementation() override;
+	virtual void OnStartCrouch(float HalfHeightAdjust, float ScaledHalfHeightAdjust) override;
+	virtual void OnEndCrouch(float HalfHeightAdjust, float ScaledHalfHeightAdjust) override;
+	virtual bool CanJumpInternal_Implementation() const override;
 	
 	// Blockers
 public:
@@ -90,15 +170,30 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "PlayerBase|Blockers")
 	int RemoveMultiBlocker(const TArray<EPlayerBlocker>& BlockerTypes, FName BlockerName);
 
-	void AddMoveSpeedModifier(const FString& Key, float Value);
-	void RemoveMoveSpeedModifier(const FString& Key);
+	// Mask forms of the above, each one map update however many blocker types the mask holds
+	void AddBlockers(FPlayerBlockerMask Mask, FName BlockerName);
+	int RemoveBlockers(FPlayerBlockerMask Mask, FName BlockerName);
+	// Blockers held until the returned handle is released or destroyed
+	[[nodiscard]] FPlayerBlockerHandle AcquireBlockers(FPlayerBlockerMask Mask);
+	// This instance's blockers together with those the server holds
+	FPlayerBlockerMask GetActiveBlockerMask() const { return ActiveBlockerMask | ServerModifiers.BlockerMask; }
+
+	// Server only, the owning client moves with the product the server replicates in ServerModifiers
+	void AddMoveSpeedModifier(FName Key, float Value);
+	void RemoveMoveSpeedModifier(FName Key);
+
+	// Testing, automated net test runs are driven by UPlayerNetTestComponent
+public:
+	// Runs ledge checks inside a trace region to confirm in Memory Insights that they do not allocate, needs -trace=default,memalloc
+	UFUNCTION(Exec)
+	void TestLedgeGrabAllocations(int32 Iterations = 100);
+
+	// Compares state change dispatch through the locomotion event bus and a dynamic delegate
+	UFUNCTION(Exec)
+	void BenchmarkLocomotionEvents(int32 Iterations = 100000);
 
 	// RPCs
 private:
-	UFUNCTION(Server, Reliable)
-	void Server_SetWalkSpeed(float Speed);
-	void Server_SetWalkSpeed_Implementation(float Speed);
-
 	UFUNCTION(Server, Reliable)
 	void Server_PrepareForLedgeGrab();
 	void Server_PrepareForLedgeGrab_Implementation();
@@ -116,8 +211,20 @@ private:
 	void Server_SetActorRotation_Implementation(FRotator Rotation);
 
 	UFUNCTION(Server, Unreliable)
-	void Server_CheckLedgeGrab();
-	void Server_CheckLedgeGrab_Implementation();
+	void Server_CheckLedgeGrab(float ClientTimeStamp);
+	void Server_CheckLedgeGrab_Implementation(float ClientTimeStamp);
+
+	void CountReceivedRpc(FName FunctionName);
+
+	UFUNCTION()
+	void OnRep_LocomotionState(EPlayerLocomotionState PreviousState);
+
+	UFUNCTION()
+	void OnRep_ServerModifiers();
+
+	// Empty listener for BenchmarkLocomotionEvents, only the dispatch is measured
+	UFUNCTION()
+	void OnLocomotionStateChangedBenchmark(EPlayerLocomotionState PreviousState, EPlayerLocomotionState NewState, APlayerBase* Player);
 	
 	// Input actions
 protected:
@@ -138,6 +245,12 @@ protected:
 	void InputActionPreviousWeapon(const FInputActionValue& Value);
 	void InputActionToggleFlashlight(const FInputActionValue& Value);
 
+	void SetInputActionHeld(EPlayerInputAction Action, bool bHeld);
+	void PressInputAction(EPlayerInputAction Action);
+	void ApplyLookInput(float DeltaTime);
+	void RecordInputEvent(EPlayerInputAction Action, bool bPressed);
+	bool ConsumeBufferedPress(EPlayerInputAction Action, float BufferWindow);
+
 	// Locomotion
 protected:
 	void UpdateLocomotionState();
@@ -151,21 +264,38 @@ protected:
 	void UpdateLocomotionStateLedgeGrabbing();
 
 	void SetLocomotionState(EPlayerLocomotionState NewState, bool bBroadcast = true);
+	void BroadcastLocomotionStateChanged(EPlayerLocomotionState PreviousState, EPlayerLocomotionState NewState);
+	void PushLocomotionEvent(EPlayerLocomotionEventType Type, EPlayerLocomotionState State);
+	// Idle states are only re-evaluated after something that could change their outcome, see UpdateLocomotionState
+	void MarkLocomotionStateDirty() { HotState.bLocomotionStateDirty = true; }
 
 private:
 	void Move();
-	float GetModifiedMoveSpeed(float StartingMoveSpeed);
+	float GetMoveSpeedModifierProduct() const;
+	float GetLedgeGrabCheckRetryDelay() const;
+	void OnMoveSpeedModifiersChanged();
+	void ApplyServerModifiers();
 	FVector GetCrouchPositionRelativeCameraBoomPosition();
-	bool CheckLedgeGrab(FTransform& OutLedgeTransform);
+	void UpdateCameraBoomLocation();
+	void UpdateCrouch(bool bWantsCrouch);
+	void RequestCeilingProbe();
+	void OnCeilingProbeComplete(const FTraceHandle& TraceHandle, FOverlapDatum& OverlapDatum);
+	void SetCrouchCameraEndpoints(bool bCrouched);
+	void UpdateCrouchCamera(float DeltaTime);
+	bool CheckLedgeGrab(const FTransform& ActorTransform, FTransform& OutLedgeTransform);
+	double GetServerTimeForClientTimeStamp(float ClientTimeStamp) const;
+	float GetClientViewRewindTime() const;
 	void PrepareForLedgeGrab();
 	void CleanUpLedgeGrab();
 
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	// Components
 protected:
+	// Camera and first person components are cosmetic, null in server builds and dormant on other dedicated servers
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
 	UBetterSpringArmComponent* CameraBoom;
 
@@ -175,8 +305,16 @@ protected:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Mesh, meta = (AllowPrivateAccess = "true"))
 	USkeletalMeshComponent* FirstPersonMesh;
 
+	// How the third person mesh animates on dedicated servers, where it is never rendered
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Mesh, meta = (AllowPrivateAccess = "true"))
+	EVisibilityBasedAnimTickOption DedicatedServerMeshTickOption = EVisibilityBasedAnimTickOption::OnlyTickMontagesWhenNotRendered;
+
+	// Stops the cosmetic components ticking and following the capsule, and drops pose updates on the meshes
+	void ConfigureForDedicatedServer();
+
 	// Events
 public:
+	// Blueprint bridge for state changes, C++ listeners subscribe to UPlayerLocomotionEventSubsystem instead
 	UPROPERTY(BlueprintAssignable, Category = "PlayerBase | Events")
 	FOnLocomotionStateChangedSignature OnLocomotionStateChanged;
 	
@@ -197,14 +335,23 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Movement|Sprint", meta = (AllowPrivateAccess = "true"))
 	float SprintSpeedMultiplier = 1.0f;
 
+	// How long a jump press is remembered if it cannot be acted on yet, e.g. pressed just before landing
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Movement|Jump", meta = (AllowPrivateAccess = "true", Units = "Seconds", ClampMin = 0.0f))
+	float JumpBufferTime = 0.15f;
+
+	// How long after walking off a ledge the player can still jump
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Movement|Jump", meta = (AllowPrivateAccess = "true", Units = "Seconds", ClampMin = 0.0f))
+	float CoyoteTime = 0.12f;
+
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Movement|Crouch", meta = (AllowPrivateAccess = "true", Units = "Seconds", ClampMin=0.00001f))
 	float CrouchSpeed = 0.2f;
 	
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Movement|Crouch", meta = (AllowPrivateAccess = "true"))
 	UCurveFloat* CrouchSpeedCurve;
-	
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Movement|Slide", meta = (AllowPrivateAccess = "true"))
-	UCurveFloat* SlideSpeedCurve;
+
+	// How often a crouched player checks for room to stand up, releasing crouch waits for the latest result
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Movement|Crouch", meta = (AllowPrivateAccess = "true", Units = "Seconds", ClampMin = 0.0f))
+	float CeilingProbeInterval = 0.1f;
 	
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Movement|Ledge Grab", meta = (AllowPrivateAccess = "true"))
 	UCurveVector* LedgeGrabMovementCurve;
@@ -215,6 +362,14 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Movement|Ledge Grab", meta = (AllowPrivateAccess = "true"))
 	float LedgeGrabDestinationForwardOffset = 40.0f;
 
+	// Moving things within this distance are rewound to where the client saw them when the server checks its ledge grab
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Movement|Ledge Grab", meta = (AllowPrivateAccess = "true"))
+	float LedgeGrabRewindRadius = 500.0f;
+
+	// A ledge grab check the server has not confirmed after this long plus the round trip time is checked and sent again
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Movement|Ledge Grab", meta = (AllowPrivateAccess = "true", Units = "Seconds", ClampMin = 0.0f))
+	float LedgeGrabCheckRetryTime = 0.1f;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Movement|Ledge Grab", meta = (AllowPrivateAccess = "true", MakeEditWidget = "true"))
 	FVector LedgeGrabTraceStart = FVector(80.0f, 0.0f, 100.0f);
 
@@ -267,50 +422,81 @@ protected:
 
 	// Input values
 protected:
-	FVector2D MoveInput;
-	FVector2D LookInput;
-	bool bJumpInput;
-	bool bPrimaryFireInput;
-	bool bAimDownSightsInput;
-	bool bReloadInput;
-	bool bSprintInput;
-	bool bCrouchInput;
-	bool bInteractInput;
-	bool bNextWeaponInput;
-	bool bPreviousWeaponInput;
-	bool bToggleFlashlightInput;
+	FPlayerInputBuffer InputBuffer;
+
+private:
+	// Input action to handler bindings, shared by every instance of the class
+	struct FInputActionBinding
+	{
+		UInputAction* APlayerBase::* Action;
+		ETriggerEvent TriggerEvent;
+		void (APlayerBase::* Handler)(const FInputActionValue&);
+	};
+	static const FInputActionBinding InputActionBindings[];
 
 protected:
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Movement, meta = (AllowPrivateAccess = "true"))
+	// Replicated to everyone but the owner, who runs the state machine, so remote players animate from it
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, ReplicatedUsing = OnRep_LocomotionState, Category = Movement, meta = (AllowPrivateAccess = "true"))
 	EPlayerLocomotionState LocomotionState;
 
-private:
-	TMap<EPlayerBlocker, TSet<FName>> Blockers;
-	TMap<FString, float> MoveSpeedModifiers;
+	// Per-tick simulation state, next to LocomotionState
+	FPlayerHotState HotState;
 
-	bool bCurrentLocomotionStateEntered = false;
+private:
+	friend class FPlayerBlockerHandle;
+	void ReleaseBlockers(FPlayerBlockerMask Mask, uint32 Generation);
+	void AdjustBlockerCounts(FPlayerBlockerMask Mask, int32 Delta);
+
+	// Blocker types each name holds
+	TMap<FName, FPlayerBlockerMask> NamedBlockers;
+	// Names and handles holding each blocker type, a type is active while its count is above zero
+	TStaticArray<uint16, (uint8)EPlayerBlocker::MAX> BlockerCounts{InPlace, 0};
+	FPlayerBlockerMask ActiveBlockerMask = 0;
+	// Bumped when the pawn is reset for reuse so handles from its previous life release nothing
+	uint32 BlockerGeneration = 0;
+	TMap<FName, float> MoveSpeedModifiers;
+
+	// Blockers and speed modifier product of the server's instance, only its owner needs them
+	UPROPERTY(ReplicatedUsing = OnRep_ServerModifiers)
+	FPlayerServerModifiers ServerModifiers;
 
 	// Ledge Grabbing
-	bool bIsLedgeGrabbing = false;
 	EMovementMode MovementModeBeforeLedgeGrab;
 	UPROPERTY(Replicated)
 	bool bServerLedgeGrabCheckSucceeded = false;
-	bool bClientLedgeGrabCheckSucceeded = false;
-	float LedgeGrabProgress;
 	FTransform LedgeGrabLedgeTransform;
 	FTransform LedgeGrabCapsuleDestination;
 	FTransform LedgeGrabStartTransform;
+	// Released by CleanUpLedgeGrab, or with the pawn if the grab never finishes
+	FPlayerBlockerHandle LedgeGrabBlockers;
+	FPlayerPhysicsProbe PhysicsProbe;
+	FCollisionShape LedgeGrabTraceShape;
+	FCollisionShape LedgeGrabDestinationShape;
+
+	// Crouching
+	FCollisionShape CeilingProbeShape;
+	FOverlapDelegate CeilingProbeDelegate;
+	FTraceHandle CeilingProbeHandle;
+	float LastCeilingProbeTime = -1.0f;
+
+	float LocomotionStateStartTime = 0.0f;
+
+	UPROPERTY(Transient)
+	UPlayerLocomotionEventSubsystem* LocomotionEvents = nullptr;
+
+	// RPC and replication accounting
+	UPROPERTY(Transient)
+	UNetAccountingSubsystem* NetAccounting = nullptr;
+	bool bLastReplicatedLedgeGrabCheckSucceeded = false;
+	EPlayerLocomotionState LastReplicatedLocomotionState = EPlayerLocomotionState::Idle;
+	FPlayerServerModifiers LastReplicatedServerModifiers;
 
-	// Sliding
-	float SlideProgress;
-	
 	// Defaults
-	float DefaultWalkSpeed;
-	float DefaultCrouchSpeed;
-	float DefaultCapsuleHalfHeight;
-	float DefaultCameraBoomZ;
-	float CrouchCapsuleResizeOffset;
-
-	// Crouch camera smoothing
-	float CrouchCameraLerpProgress;
+	static FPlayerClassDefaults GetClassDefaults(const UClass* Class);
+	FPlayerClassDefaults Defaults;
+	bool bCosmeticComponentsDormant = false;
+
+	// Script and replay the same input edges the input actions produce
+	friend class UPlayerNetTestComponent;
+	friend class UPlayerInputReplayComponent;
 };
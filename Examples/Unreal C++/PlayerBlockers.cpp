@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Player/PlayerBlockers.h"
+#include "Player/PlayerBase.h"
+
+FPlayerBlockerMask PlayerBlockers::MakeMask(TConstArrayView<EPlayerBlocker> Types)
+{
+	FPlayerBlockerMask Mask = 0;
+	for (EPlayerBlocker BlockerType : Types)
+		Mask |= GetBit(BlockerType);
+	return Mask;
+}
+
+bool FPlayerServerModifiers::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	Ar << BlockerMask;
+	Ar << QuantizedSpeedScale;
+	bOutSuccess = true;
+	return true;
+}
+
+FPlayerBlockerHandle::FPlayerBlockerHandle(APlayerBase* InPlayer, FPlayerBlockerMask InMask, uint32 InGeneration) :
+	Player(InPlayer),
+	Mask(InMask),
+	Generation(InGeneration)
+{
+}
+
+FPlayerBlockerHandle::FPlayerBlockerHandle(FPlayerBlockerHandle&& Other) :
+	Player(MoveTemp(Other.Player)),
+	Mask(Other.Mask),
+	Generation(Other.Generation)
+{
+	Other.Player.Reset();
+	Other.Mask = 0;
+}
+
+FPlayerBlockerHandle& FPlayerBlockerHandle::operator=(FPlayerBlockerHandle&& Other)
+{
+	if (this != &Other)
+	{
+		Release();
+		Player = MoveTemp(Other.Player);
+		Mask = Other.Mask;
+		Generation = Other.Generation;
+		Other.Player.Reset();
+		Other.Mask = 0;
+	}
+	return *this;
+}
+
+void FPlayerBlockerHandle::Release()
+{
+	// A pawn that is gone took its blockers with it
+	if (APlayerBase* PlayerBase = Player.Get())
+		PlayerBase->ReleaseBlockers(Mask, Generation);
+
+	Player.Reset();
+	Mask = 0;
+}
@@ -0,0 +1,112 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/WeakObjectPtrTemplates.h"
+#include "PlayerBlockers.generated.h"
+
+class APlayerBase;
+
+UENUM(BlueprintType)
+enum class EPlayerBlocker : uint8
+{
+	Movement,
+	Look,
+	Sprint,
+	Crouch,
+	Slide,
+	Jump,
+	Interact,
+	ToggleFlashlight,
+	PrimaryFire,
+	SecondaryFire,
+	Reload,
+	AimDownSights,
+	WeaponSwap,
+	MAX UMETA(Hidden),
+};
+
+// One bit per EPlayerBlocker, the form blockers are stored, sent with moves and recorded in
+using FPlayerBlockerMask = uint16;
+
+static_assert(static_cast<uint8>(EPlayerBlocker::MAX) <= 16, "Blockers no longer fit in FPlayerBlockerMask");
+
+namespace PlayerBlockers
+{
+	constexpr FPlayerBlockerMask AllMask = (1 << static_cast<uint8>(EPlayerBlocker::MAX)) - 1;
+
+	constexpr FPlayerBlockerMask GetBit(EPlayerBlocker BlockerType) { return FPlayerBlockerMask(1) << static_cast<uint8>(BlockerType); }
+
+	// Precompute masks for fixed blocker sets, MakeMask(EPlayerBlocker::Movement, EPlayerBlocker::Jump)
+	template<typename... BlockerTypes>
+	constexpr FPlayerBlockerMask MakeMask(BlockerTypes... Types) { return (FPlayerBlockerMask(0) | ... | GetBit(Types)); }
+
+	HORDESHOOTER_API FPlayerBlockerMask MakeMask(TConstArrayView<EPlayerBlocker> Types);
+}
+
+/**
+ * Blockers and speed modifier product the server holds for a player, replicated to its owner as four bytes.
+ * Property replication only sends it when one of them changes.
+ */
+USTRUCT()
+struct HORDESHOOTER_API FPlayerServerModifiers
+{
+	GENERATED_BODY()
+
+	// Speed scales are sent in steps of 1/4096, up to just under 16
+	static constexpr float SpeedScaleSteps = 4096.0f;
+
+	UPROPERTY()
+	uint16 BlockerMask = 0;
+
+	UPROPERTY()
+	uint16 QuantizedSpeedScale = 4096;
+
+	float GetSpeedScale() const { return QuantizedSpeedScale / SpeedScaleSteps; }
+	void SetSpeedScale(float Scale) { QuantizedSpeedScale = (uint16)FMath::Clamp(FMath::RoundToInt(Scale * SpeedScaleSteps), 0, (int32)MAX_uint16); }
+
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+
+	bool operator==(const FPlayerServerModifiers& Other) const { return BlockerMask == Other.BlockerMask && QuantizedSpeedScale == Other.QuantizedSpeedScale; }
+	bool operator!=(const FPlayerServerModifiers& Other) const { return !(*this == Other); }
+};
+
+template<>
+struct TStructOpsTypeTraits<FPlayerServerModifiers> : public TStructOpsTypeTraitsBase2<FPlayerServerModifiers>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
+};
+
+/**
+ * Holds a mask of blockers on a player until it is released, reassigned or destroyed.
+ * Blockers held through handles never collide with named blockers, so nothing else can remove them early.
+ * Handles taken before the pawn was reset for reuse release nothing.
+ */
+class HORDESHOOTER_API FPlayerBlockerHandle
+{
+public:
+	FPlayerBlockerHandle() = default;
+	~FPlayerBlockerHandle() { Release(); }
+
+	FPlayerBlockerHandle(FPlayerBlockerHandle&& Other);
+	FPlayerBlockerHandle& operator=(FPlayerBlockerHandle&& Other);
+	FPlayerBlockerHandle(const FPlayerBlockerHandle&) = delete;
+	FPlayerBlockerHandle& operator=(const FPlayerBlockerHandle&) = delete;
+
+	void Release();
+	bool IsHeld() const { return Mask != 0; }
+	FPlayerBlockerMask GetMask() const { return Mask; }
+
+private:
+	friend class APlayerBase;
+	FPlayerBlockerHandle(APlayerBase* InPlayer, FPlayerBlockerMask InMask, uint32 InGeneration);
+
+	TWeakObjectPtr<APlayerBase> Player;
+	FPlayerBlockerMask Mask = 0;
+	uint32 Generation = 0;
+};
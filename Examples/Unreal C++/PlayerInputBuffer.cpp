@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Player/PlayerInputBuffer.h"
+
+bool FPlayerInputState::SetHeld(EPlayerInputAction Action, bool bHeld)
+{
+	const uint16 Bit = GetActionBit(Action);
+	if (((Held & Bit) != 0) == bHeld)
+		return false;
+
+	if (bHeld)
+	{
+		Held |= Bit;
+		Pressed |= Bit;
+	}
+	else
+	{
+		Held &= ~Bit;
+		Released |= Bit;
+	}
+	return true;
+}
+
+void FPlayerInputBuffer::Record(EPlayerInputAction Action, bool bPressed, double Timestamp)
+{
+	Events.Add({ Action, bPressed, Timestamp });
+}
+
+bool FPlayerInputBuffer::ConsumePress(EPlayerInputAction Action, double Now, float BufferWindow, double& OutTimestamp)
+{
+	const int32 Index = FindPress(Action, Now, BufferWindow);
+	if (Index == INDEX_NONE)
+		return false;
+
+	OutTimestamp = Events[Index].Timestamp;
+	Events.RemoveAt(Index, 1, EAllowShrinking::No);
+	return true;
+}
+
+bool FPlayerInputBuffer::HasPress(EPlayerInputAction Action, double Now, float BufferWindow) const
+{
+	return FindPress(Action, Now, BufferWindow) != INDEX_NONE;
+}
+
+void FPlayerInputBuffer::Prune(double Now, float MaxAge)
+{
+	// Events are recorded in order, so everything stale is at the front
+	int32 NumStale = 0;
+	while (NumStale < Events.Num() && Now - Events[NumStale].Timestamp > MaxAge)
+	{
+		NumStale++;
+	}
+
+	if (NumStale > 0)
+		Events.RemoveAt(0, NumStale, EAllowShrinking::No);
+}
+
+void FPlayerInputBuffer::Clear()
+{
+	Events.Reset();
+}
+
+int32 FPlayerInputBuffer::FindPress(EPlayerInputAction Action, double Now, float BufferWindow) const
+{
+	for (int32 i = Events.Num() - 1; i >= 0; i--)
+	{
+		const FPlayerInputEvent& Event = Events[i];
+		if (Now - Event.Timestamp > BufferWindow)
+			break;
+
+		if (Event.Action == Action && Event.bPressed)
+			return i;
+	}
+	return INDEX_NONE;
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PlayerInputBuffer.generated.h"
+
+UENUM(BlueprintType)
+enum class EPlayerInputAction : uint8
+{
+	Jump,
+	PrimaryFire,
+	AimDownSights,
+	Reload,
+	Sprint,
+	Crouch,
+	Interact,
+	NextWeapon,
+	PreviousWeapon,
+	ToggleFlashlight,
+	MAX UMETA(Hidden),
+};
+
+static_assert(static_cast<uint8>(EPlayerInputAction::MAX) <= 16, "Input actions no longer fit in FPlayerInputState bits");
+
+/**
+ * Input action state packed into one bit per EPlayerInputAction.
+ * Held is the packed word saved into moves and replays, Pressed and Released are this frame's edges.
+ */
+struct FPlayerInputState
+{
+	uint16 Held = 0;
+	uint16 Pressed = 0;
+	uint16 Released = 0;
+
+	static uint16 GetActionBit(EPlayerInputAction Action) { return 1 << static_cast<uint8>(Action); }
+
+	bool IsHeld(EPlayerInputAction Action) const { return (Held & GetActionBit(Action)) != 0; }
+	bool WasPressed(EPlayerInputAction Action) const { return (Pressed & GetActionBit(Action)) != 0; }
+	bool WasReleased(EPlayerInputAction Action) const { return (Released & GetActionBit(Action)) != 0; }
+
+	// Returns whether the held state changed
+	bool SetHeld(EPlayerInputAction Action, bool bHeld);
+	// Press edge for actions that are never held (fire once on Started)
+	void Press(EPlayerInputAction Action) { Pressed |= GetActionBit(Action); }
+	void ClearEdges() { Pressed = 0; Released = 0; }
+	void Reset() { Held = 0; ClearEdges(); }
+};
+
+struct FPlayerInputEvent
+{
+	EPlayerInputAction Action;
+	bool bPressed;
+	double Timestamp;
+};
+
+/**
+ * Timestamped record of recent input action presses and releases.
+ * Keeps presses that start and end within a single frame, and lets the locomotion state machine
+ * act on a press that happened slightly before it was able to (jump buffering, coyote time).
+ */
+class HORDESHOOTER_API FPlayerInputBuffer
+{
+public:
+	void Record(EPlayerInputAction Action, bool bPressed, double Timestamp);
+
+	// Removes the most recent unconsumed press of Action made within BufferWindow seconds of Now, returns whether there was one
+	bool ConsumePress(EPlayerInputAction Action, double Now, float BufferWindow, double& OutTimestamp);
+	bool HasPress(EPlayerInputAction Action, double Now, float BufferWindow) const;
+
+	// Drops events older than MaxAge seconds
+	void Prune(double Now, float MaxAge);
+	void Clear();
+
+private:
+	int32 FindPress(EPlayerInputAction Action, double Now, float BufferWindow) const;
+
+private:
+	TArray<FPlayerInputEvent, TInlineAllocator<16>> Events;
+};
@@ -0,0 +1,222 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Player/PlayerInputRecording.h"
+#include "Player/PlayerBase.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Async/MappedFileHandle.h"
+
+namespace
+{
+	const uint32 RecordingMagic = 0x52495348; // 'HSIR'
+	const uint16 RecordingVersion = 1;
+
+	struct FPlayerInputRecordingHeader
+	{
+		uint32 Magic;
+		uint16 Version;
+		uint16 FrameSize;
+	};
+
+	enum class ERecordType : uint8
+	{
+		Frame,
+		Event,
+	};
+}
+
+FPlayerInputRecorder::~FPlayerInputRecorder()
+{
+	Close();
+}
+
+bool FPlayerInputRecorder::Open(const FString& FilePath)
+{
+	Close();
+
+	Writer.Reset(IFileManager::Get().CreateFileWriter(*FilePath));
+	if (!Writer)
+	{
+		UE_LOG(LogPlayerBase, Error, TEXT("Failed to open input recording '%s' for writing!"), *FilePath);
+		return false;
+	}
+
+	FPlayerInputRecordingHeader Header = { RecordingMagic, RecordingVersion, sizeof(FPlayerInputRecordFrame) };
+	Writer->Serialize(&Header, sizeof(Header));
+	NumFrames = 0;
+
+	UE_LOG(LogPlayerBase, Display, TEXT("Recording input to '%s'"), *FilePath);
+	return true;
+}
+
+void FPlayerInputRecorder::Close()
+{
+	if (!Writer)
+		return;
+
+	Writer->Close();
+	Writer.Reset();
+	UE_LOG(LogPlayerBase, Display, TEXT("Input recording closed, %d frames"), NumFrames);
+}
+
+void FPlayerInputRecorder::RecordFrame(const FPlayerInputRecordFrame& Frame)
+{
+	if (!Writer)
+		return;
+
+	uint8 Type = static_cast<uint8>(ERecordType::Frame);
+	Writer->Serialize(&Type, sizeof(Type));
+	Writer->Serialize(const_cast<FPlayerInputRecordFrame*>(&Frame), sizeof(Frame));
+	NumFrames++;
+}
+
+void FPlayerInputRecorder::RecordEvent(EPlayerInputSessionEvent Event, const FString& Detail)
+{
+	if (!Writer)
+		return;
+
+	// Details are short names (maps), stored as length prefixed UTF-8
+	const FTCHARToUTF8 DetailUtf8(*Detail.Left(MAX_uint8));
+	uint8 Type = static_cast<uint8>(ERecordType::Event);
+	uint8 EventType = static_cast<uint8>(Event);
+	uint8 DetailLength = static_cast<uint8>(FMath::Min(DetailUtf8.Length(), static_cast<int32>(MAX_uint8)));
+	Writer->Serialize(&Type, sizeof(Type));
+	Writer->Serialize(&EventType, sizeof(EventType));
+	Writer->Serialize(&DetailLength, sizeof(DetailLength));
+	Writer->Serialize(const_cast<ANSICHAR*>(DetailUtf8.Get()), DetailLength);
+}
+
+FPlayerInputPlayback::~FPlayerInputPlayback()
+{
+	Close();
+}
+
+bool FPlayerInputPlayback::Open(const FString& FilePath)
+{
+	Close();
+
+	MappedFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*FilePath));
+	if (MappedFile)
+		MappedRegion.Reset(MappedFile->MapRegion());
+
+	if (!MappedRegion || MappedRegion->GetMappedSize() < static_cast<int64>(sizeof(FPlayerInputRecordingHeader)))
+	{
+		UE_LOG(LogPlayerBase, Error, TEXT("Failed to map input recording '%s'!"), *FilePath);
+		Close();
+		return false;
+	}
+
+	FPlayerInputRecordingHeader Header;
+	FMemory::Memcpy(&Header, MappedRegion->GetMappedPtr(), sizeof(Header));
+	if (Header.Magic != RecordingMagic || Header.Version != RecordingVersion || Header.FrameSize != sizeof(FPlayerInputRecordFrame))
+	{
+		UE_LOG(LogPlayerBase, Error, TEXT("'%s' is not a compatible input recording!"), *FilePath);
+		Close();
+		return false;
+	}
+
+	Offset = sizeof(Header);
+	UE_LOG(LogPlayerBase, Display, TEXT("Replaying input from '%s'"), *FilePath);
+	return true;
+}
+
+void FPlayerInputPlayback::Close()
+{
+	MappedRegion.Reset();
+	MappedFile.Reset();
+	Offset = 0;
+}
+
+bool FPlayerInputPlayback::IsFinished() const
+{
+	uint8 Type;
+	return !PeekRecord(Type);
+}
+
+bool FPlayerInputPlayback::ReadFrame(FPlayerInputRecordFrame& OutFrame)
+{
+	uint8 Type;
+	while (PeekRecord(Type))
+	{
+		if (Type == static_cast<uint8>(ERecordType::Frame))
+		{
+			if (Offset + 1 + static_cast<int64>(sizeof(OutFrame)) > MappedRegion->GetMappedSize())
+				break;
+
+			FMemory::Memcpy(&OutFrame, MappedRegion->GetMappedPtr() + Offset + 1, sizeof(OutFrame));
+			Offset += 1 + sizeof(OutFrame);
+			return true;
+		}
+
+		// A new possession starts the next player's frames, leave it for SkipToEvent
+		const int64 EventOffset = Offset;
+		EPlayerInputSessionEvent Event;
+		FString Detail;
+		if (!ReadEvent(Event, Detail))
+			break;
+
+		if (Event == EPlayerInputSessionEvent::Possessed)
+		{
+			Offset = EventOffset;
+			return false;
+		}
+
+		UE_LOG(LogPlayerBase, Display, TEXT("Input replay reached %s event '%s'"), Event == EPlayerInputSessionEvent::MapLoaded ? TEXT("MapLoaded") : TEXT("Unknown"), *Detail);
+	}
+
+	// Truncated or finished
+	Offset = MappedRegion.IsValid() ? MappedRegion->GetMappedSize() : 0;
+	return false;
+}
+
+bool FPlayerInputPlayback::SkipToEvent(EPlayerInputSessionEvent Event)
+{
+	uint8 Type;
+	while (PeekRecord(Type))
+	{
+		if (Type == static_cast<uint8>(ERecordType::Frame))
+		{
+			Offset += 1 + sizeof(FPlayerInputRecordFrame);
+			continue;
+		}
+
+		EPlayerInputSessionEvent ReadEventType;
+		FString Detail;
+		if (!ReadEvent(ReadEventType, Detail))
+			return false;
+
+		if (ReadEventType == Event)
+			return true;
+	}
+	return false;
+}
+
+bool FPlayerInputPlayback::PeekRecord(uint8& OutType) const
+{
+	if (!MappedRegion || Offset >= MappedRegion->GetMappedSize())
+		return false;
+
+	OutType = MappedRegion->GetMappedPtr()[Offset];
+	return true;
+}
+
+bool FPlayerInputPlayback::ReadEvent(EPlayerInputSessionEvent& OutEvent, FString& OutDetail)
+{
+	const uint8* Data = MappedRegion->GetMappedPtr();
+	const int64 Size = MappedRegion->GetMappedSize();
+	if (Offset + 3 > Size)
+	{
+		Offset = Size;
+		return false;
+	}
+
+	OutEvent = static_cast<EPlayerInputSessionEvent>(Data[Offset + 1]);
+	const uint8 DetailLength = Data[Offset + 2];
+	Offset += 3;
+
+	const int64 DetailEnd = FMath::Min(Offset + DetailLength, Size);
+	OutDetail = FString(FUTF8ToTCHAR(reinterpret_cast<const ANSICHAR*>(Data + Offset), DetailEnd - Offset));
+	Offset = DetailEnd;
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+// Session events recorded between input frames so playback stays aligned with the session
+enum class EPlayerInputSessionEvent : uint8
+{
+	MapLoaded,
+	Possessed,
+};
+
+// Input of one frame of a locally controlled player, written to recordings as is
+struct FPlayerInputRecordFrame
+{
+	float DeltaTime = 0.0f;
+	FVector2f MoveInput = FVector2f::ZeroVector;
+	FVector2f LookInput = FVector2f::ZeroVector;
+	uint16 HeldBits = 0;
+	uint16 PressedBits = 0;
+};
+
+static_assert(sizeof(FPlayerInputRecordFrame) == 24, "FPlayerInputRecordFrame layout is part of the recording format");
+
+/**
+ * Writes a player's input frames and session events to a compact binary recording.
+ * A recording is a header followed by records, each a type byte and its payload.
+ */
+class HORDESHOOTER_API FPlayerInputRecorder
+{
+public:
+	~FPlayerInputRecorder();
+
+	bool Open(const FString& FilePath);
+	void Close();
+	bool IsRecording() const { return Writer.IsValid(); }
+
+	void RecordFrame(const FPlayerInputRecordFrame& Frame);
+	void RecordEvent(EPlayerInputSessionEvent Event, const FString& Detail = FString());
+
+	int32 GetNumFrames() const { return NumFrames; }
+
+private:
+	TUniquePtr<FArchive> Writer;
+	int32 NumFrames = 0;
+};
+
+/**
+ * Plays a recording back from a memory mapped file, one frame per call.
+ */
+class HORDESHOOTER_API FPlayerInputPlayback
+{
+public:
+	~FPlayerInputPlayback();
+
+	bool Open(const FString& FilePath);
+	void Close();
+	bool IsPlaying() const { return MappedRegion.IsValid(); }
+	bool IsFinished() const;
+
+	// Reads the next frame, returns false at the next Possessed event or the end of the recording
+	bool ReadFrame(FPlayerInputRecordFrame& OutFrame);
+	// Skips past the next event of this type, returns false if there is none
+	bool SkipToEvent(EPlayerInputSessionEvent Event);
+
+private:
+	bool PeekRecord(uint8& OutType) const;
+	bool ReadEvent(EPlayerInputSessionEvent& OutEvent, FString& OutDetail);
+
+private:
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+	int64 Offset = 0;
+};
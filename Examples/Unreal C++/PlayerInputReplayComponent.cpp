@@ -0,0 +1,144 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Player/PlayerInputReplayComponent.h"
+#include "Player/PlayerBase.h"
+#include "Player/PlayerInputRecording.h"
+#include "MultiplayerGameInstance.h"
+
+UPlayerInputReplayComponent::UPlayerInputReplayComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.TickGroup = TG_PrePhysics;
+}
+
+void UPlayerInputReplayComponent::OnPlayerPossessed(APlayerBase* Player)
+{
+	UPlayerInputReplayComponent* InputReplay = Player->FindComponentByClass<UPlayerInputReplayComponent>();
+	if (!InputReplay)
+	{
+		InputReplay = NewObject<UPlayerInputReplayComponent>(Player, TEXT("InputReplay"));
+		InputReplay->RegisterComponent();
+	}
+	InputReplay->StartPossession();
+}
+
+void UPlayerInputReplayComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Recorded input has to be in place before the player's state machine reads it
+	if (APlayerBase* Player = GetPlayer())
+		Player->PrimaryActorTick.AddPrerequisite(this, PrimaryComponentTick);
+}
+
+void UPlayerInputReplayComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	const APlayerBase* Player = GetPlayer();
+	if (!Player || !Player->IsLocallyControlled())
+		return;
+
+	// Recorded input drives this player during a replay
+	if (bIsReplaying)
+		UpdateReplay();
+
+	// Capture this frame's input into the input recording
+	RecordFrame(DeltaTime);
+}
+
+APlayerBase* UPlayerInputReplayComponent::GetPlayer() const
+{
+	return Cast<APlayerBase>(GetOwner());
+}
+
+UMultiplayerGameInstance* UPlayerInputReplayComponent::GetMultiplayerGameInstance() const
+{
+	const UWorld* World = GetWorld();
+	return World ? World->GetGameInstance<UMultiplayerGameInstance>() : nullptr;
+}
+
+void UPlayerInputReplayComponent::StartPossession()
+{
+	// The controller processes this frame's input before the component reads or overrides it
+	if (AController* Controller = GetPlayer()->GetController())
+		AddTickPrerequisiteActor(Controller);
+
+	// Input recordings mark each possession so playback can pick up where this player starts
+	if (UMultiplayerGameInstance* GameInstance = GetMultiplayerGameInstance())
+	{
+		if (FPlayerInputRecorder* Recorder = GameInstance->GetInputRecorder())
+			Recorder->RecordEvent(EPlayerInputSessionEvent::Possessed, GetPlayer()->GetName());
+		if (FPlayerInputPlayback* Playback = GameInstance->GetInputPlayback())
+			bIsReplaying = Playback->SkipToEvent(EPlayerInputSessionEvent::Possessed);
+	}
+}
+
+void UPlayerInputReplayComponent::UpdateReplay()
+{
+	UMultiplayerGameInstance* GameInstance = GetMultiplayerGameInstance();
+	FPlayerInputPlayback* Playback = GameInstance ? GameInstance->GetInputPlayback() : nullptr;
+	FPlayerInputRecordFrame Frame;
+	if (!Playback || !Playback->ReadFrame(Frame))
+	{
+		// This player's part of the recording is over, release everything
+		StopReplay();
+		UE_LOG(LogPlayerBase, Display, TEXT("'%s' Input replay finished"), *GetNameSafe(GetOwner()));
+		if (Playback && Playback->IsFinished() && FParse::Param(FCommandLine::Get(), TEXT("ReplayQuitWhenDone")))
+			FPlatformMisc::RequestExit(false);
+		return;
+	}
+
+	// Go through the same edges as the input actions so the state machine sees recorded presses
+	APlayerBase* Player = GetPlayer();
+	Player->HotState.MoveInput = FVector2D(Frame.MoveInput);
+	Player->HotState.PendingLookInput += FVector2D(Frame.LookInput);
+	for (uint8 i = 0; i < static_cast<uint8>(EPlayerInputAction::MAX); i++)
+	{
+		const EPlayerInputAction Action = static_cast<EPlayerInputAction>(i);
+		const uint16 Bit = FPlayerInputState::GetActionBit(Action);
+		const bool bHeld = (Frame.HeldBits & Bit) != 0;
+
+		if (Action == EPlayerInputAction::Jump && !bHeld && Player->HotState.InputState.IsHeld(Action))
+			Player->StopJumping();
+
+		// Presses released within the same frame only show up as a press edge
+		const bool bPressedOnly = !bHeld && !Player->HotState.InputState.IsHeld(Action) && (Frame.PressedBits & Bit) != 0;
+		Player->SetInputActionHeld(Action, bHeld);
+		if (bPressedOnly)
+			Player->PressInputAction(Action);
+	}
+}
+
+void UPlayerInputReplayComponent::StopReplay()
+{
+	bIsReplaying = false;
+
+	APlayerBase* Player = GetPlayer();
+	Player->HotState.MoveInput = FVector2D::ZeroVector;
+	if (Player->HotState.InputState.IsHeld(EPlayerInputAction::Jump))
+		Player->StopJumping();
+	for (uint8 i = 0; i < static_cast<uint8>(EPlayerInputAction::MAX); i++)
+	{
+		Player->SetInputActionHeld(static_cast<EPlayerInputAction>(i), false);
+	}
+}
+
+void UPlayerInputReplayComponent::RecordFrame(float DeltaTime)
+{
+	UMultiplayerGameInstance* GameInstance = GetMultiplayerGameInstance();
+	FPlayerInputRecorder* Recorder = GameInstance ? GameInstance->GetInputRecorder() : nullptr;
+	if (!Recorder)
+		return;
+
+	// Look input waits in PendingLookInput until the player applies it later this frame
+	const APlayerBase* Player = GetPlayer();
+	FPlayerInputRecordFrame Frame;
+	Frame.DeltaTime = DeltaTime;
+	Frame.MoveInput = FVector2f(Player->HotState.MoveInput);
+	Frame.LookInput = FVector2f(Player->HotState.PendingLookInput);
+	Frame.HeldBits = Player->HotState.InputState.Held;
+	Frame.PressedBits = Player->HotState.InputState.Pressed;
+	Recorder->RecordFrame(Frame);
+}
@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "PlayerInputReplayComponent.generated.h"
+
+class APlayerBase;
+class UMultiplayerGameInstance;
+
+/**
+ * Records a locally controlled player's input into the game instance's input recording and plays recordings back,
+ * see UMultiplayerGameInstance::StartInputRecording and -ReplayInput=<name>. Only added in non-shipping builds.
+ * Ticks between the player's controller and the player, after this frame's input is in and before the state machine reads it.
+ */
+UCLASS()
+class HORDESHOOTER_API UPlayerInputReplayComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UPlayerInputReplayComponent();
+
+	// Adds the component to a player the first time it is possessed locally and marks the possession in recordings
+	static void OnPlayerPossessed(APlayerBase* Player);
+
+	virtual void BeginPlay() override;
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+private:
+	APlayerBase* GetPlayer() const;
+	UMultiplayerGameInstance* GetMultiplayerGameInstance() const;
+	void StartPossession();
+	void UpdateReplay();
+	void StopReplay();
+	void RecordFrame(float DeltaTime);
+
+private:
+	bool bIsReplaying = false;
+};
@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Player/PlayerLocomotionEventSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Locomotion Event Flush"), STAT_LocomotionEventFlush, STATGROUP_Game);
+
+void UPlayerLocomotionEventSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	Flush();
+}
+
+TStatId UPlayerLocomotionEventSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPlayerLocomotionEventSubsystem, STATGROUP_Tickables);
+}
+
+void UPlayerLocomotionEventSubsystem::Push(EPlayerLocomotionEventType Type, EPlayerLocomotionState State, APlayerBase* Player)
+{
+	PendingEvents.Add({ Type, State, Player });
+}
+
+void UPlayerLocomotionEventSubsystem::Flush()
+{
+	if (PendingEvents.IsEmpty())
+		return;
+
+	SCOPE_CYCLE_COUNTER(STAT_LocomotionEventFlush);
+
+	// Swap rather than copy so both queues keep their allocations
+	Swap(PendingEvents, DispatchingEvents);
+	for (const FPlayerLocomotionEvent& Event : DispatchingEvents)
+	{
+		Subscribers[(uint8)Event.Type].Broadcast(Event);
+	}
+	DispatchingEvents.Reset();
+}
\ No newline at end of file
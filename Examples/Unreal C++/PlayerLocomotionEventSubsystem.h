@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Player/PlayerBase.h"
+#include "PlayerLocomotionEventSubsystem.generated.h"
+
+enum class EPlayerLocomotionEventType : uint8
+{
+	StateEnter,
+	StateExit,
+	LedgeGrabStart,
+	LedgeGrabEnd,
+	SlideStart,
+	SlideEnd,
+	MAX
+};
+
+struct FPlayerLocomotionEvent
+{
+	EPlayerLocomotionEventType Type = EPlayerLocomotionEventType::StateEnter;
+	// The state entered or exited, the player's current state for the other events
+	EPlayerLocomotionState State = EPlayerLocomotionState::Idle;
+	TWeakObjectPtr<APlayerBase> Player;
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnPlayerLocomotionEvent, const FPlayerLocomotionEvent&);
+
+/**
+ * Locomotion events of every player in the world, queued as they happen and dispatched together once per frame.
+ * Subscribers bind to the event types they care about and filter by player themselves.
+ * Queues keep their capacity between frames, so steady state dispatch does not allocate.
+ */
+UCLASS()
+class HORDESHOOTER_API UPlayerLocomotionEventSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void Push(EPlayerLocomotionEventType Type, EPlayerLocomotionState State, APlayerBase* Player);
+	// Dispatches everything queued so far, events pushed by subscribers wait for the next flush
+	void Flush();
+
+	FOnPlayerLocomotionEvent& OnEvent(EPlayerLocomotionEventType Type) { return Subscribers[(uint8)Type]; }
+
+private:
+	TStaticArray<FOnPlayerLocomotionEvent, (uint8)EPlayerLocomotionEventType::MAX> Subscribers;
+	TArray<FPlayerLocomotionEvent> PendingEvents;
+	TArray<FPlayerLocomotionEvent> DispatchingEvents;
+};
@@ -0,0 +1,225 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Player/PlayerNetTestComponent.h"
+#include "Player/PlayerBase.h"
+#include "Player/PlayerLocomotionEventSubsystem.h"
+#include "Base/CustomCharacterMovementComponent.h"
+#include "Base/NetAccountingSubsystem.h"
+#include "Engine/NetConnection.h"
+#include "Engine/World.h"
+
+namespace
+{
+	// One step of the scripted input sequence used by automated network tests
+	struct FNetTestInputStep
+	{
+		float Duration;
+		FVector2D MoveInput;
+		bool bSprintInput;
+		bool bCrouchInput;
+		bool bJumpInput;
+	};
+
+	// Walk, sprint into a slide, then run and jump at whatever is in front of the player to attempt a ledge grab
+	const FNetTestInputStep NetTestSequence[] =
+	{
+		{ 1.0f, FVector2D(0.0f, 1.0f), false, false, false },
+		{ 1.5f, FVector2D(0.0f, 1.0f), true, false, false },
+		{ 1.0f, FVector2D(0.0f, 1.0f), true, true, false },
+		{ 0.5f, FVector2D::ZeroVector, false, false, false },
+		{ 0.5f, FVector2D(0.0f, 1.0f), false, false, false },
+		{ 1.5f, FVector2D(0.0f, 1.0f), false, false, true },
+		{ 1.0f, FVector2D::ZeroVector, false, false, false },
+	};
+
+	int32 GetRequestedLoops()
+	{
+		static const int32 Loops = []()
+		{
+			int32 Value = 0;
+			FParse::Value(FCommandLine::Get(), TEXT("NetTestLoops="), Value);
+			return Value;
+		}();
+		return Loops;
+	}
+
+	bool IsReportRequested()
+	{
+		static const bool bReport = FParse::Param(FCommandLine::Get(), TEXT("NetTestReport"));
+		return bReport;
+	}
+
+	float GetPercentile(const TArray<float>& UnsortedSamples, float Percentile)
+	{
+		if (UnsortedSamples.IsEmpty())
+			return 0.0f;
+
+		TArray<float> Samples(UnsortedSamples);
+		Samples.Sort();
+		const int32 Index = FMath::Clamp(FMath::CeilToInt(Percentile * Samples.Num()) - 1, 0, Samples.Num() - 1);
+		return Samples[Index];
+	}
+}
+
+UPlayerNetTestComponent::UPlayerNetTestComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.TickGroup = TG_PrePhysics;
+}
+
+bool UPlayerNetTestComponent::IsRequested()
+{
+	return GetRequestedLoops() > 0 || IsReportRequested();
+}
+
+void UPlayerNetTestComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Scripted input has to be in place before the player's state machine reads it
+	if (APlayerBase* Player = GetPlayer())
+		Player->PrimaryActorTick.AddPrerequisite(this, PrimaryComponentTick);
+
+	if (UPlayerLocomotionEventSubsystem* LocomotionEvents = GetWorld()->GetSubsystem<UPlayerLocomotionEventSubsystem>())
+		StateEnterHandle = LocomotionEvents->OnEvent(EPlayerLocomotionEventType::StateEnter).AddUObject(this, &UPlayerNetTestComponent::OnStateEnter);
+}
+
+void UPlayerNetTestComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// The server reports the RPCs it received from each player when that player leaves a net test run
+	const APlayerBase* Player = GetPlayer();
+	if (Player && Player->HasAuthority() && !Player->IsLocallyControlled() && IsReportRequested())
+		LogReport();
+
+	if (UPlayerLocomotionEventSubsystem* LocomotionEvents = GetWorld()->GetSubsystem<UPlayerLocomotionEventSubsystem>())
+		LocomotionEvents->OnEvent(EPlayerLocomotionEventType::StateEnter).Remove(StateEnterHandle);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UPlayerNetTestComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	const APlayerBase* Player = GetPlayer();
+	if (!Player || !Player->IsLocallyControlled())
+		return;
+
+	// Runs once per pawn, as soon as the local player controls it
+	if (!bSequenceStarted && GetRequestedLoops() > 0)
+		StartSequence(GetRequestedLoops());
+
+	if (LoopsRemaining > 0)
+		UpdateSequence(DeltaTime);
+}
+
+void UPlayerNetTestComponent::StartSequence(int32 Loops)
+{
+	bSequenceStarted = true;
+	LoopsRemaining = FMath::Max(Loops, 0);
+	StepIndex = 0;
+	StepTime = 0.0f;
+	UE_LOG(LogPlayerBase, Display, TEXT("'%s' Starting net test sequence, %d loops"), *GetNameSafe(GetOwner()), LoopsRemaining);
+}
+
+void UPlayerNetTestComponent::LogReport() const
+{
+	const APlayerBase* Player = GetPlayer();
+	if (!Player)
+		return;
+
+	const int32 NumCorrections = Player->GetCustomCharacterMovement()->GetNumClientCorrections();
+
+	UNetConnection* Connection = Player->GetNetConnection();
+	const int32 InBytesPerSecond = Connection ? Connection->InBytesPerSecond : 0;
+	const int32 OutBytesPerSecond = Connection ? Connection->OutBytesPerSecond : 0;
+
+	// Received RPCs come from net accounting, so they are only counted while it is enabled
+	const UNetAccountingSubsystem* NetAccounting = GetWorld()->GetSubsystem<UNetAccountingSubsystem>();
+	const int64 NumServerRpcsReceived = NetAccounting && Player->HasAuthority() ? NetAccounting->GetNumReceivedRpcs(Connection) : 0;
+
+	// Single line so the test matrix script can parse it out of the log
+	UE_LOG(LogPlayerBase, Display, TEXT("NetTestReport Player=%s Role=%s Corrections=%d ServerRpcsReceived=%lld InBytesPerSec=%d OutBytesPerSec=%d ")
+		TEXT("SprintMs=%.1f/%.1f/%.1f SlideMs=%.1f/%.1f/%.1f LedgeGrabMs=%.1f/%.1f/%.1f LedgeGrabs=%d"),
+		*GetNameSafe(Player), *UEnum::GetValueAsString(Player->GetLocalRole()), NumCorrections, NumServerRpcsReceived, InBytesPerSecond, OutBytesPerSecond,
+		GetPercentile(SprintLatencies, 0.5f), GetPercentile(SprintLatencies, 0.9f), GetPercentile(SprintLatencies, 0.99f),
+		GetPercentile(SlideLatencies, 0.5f), GetPercentile(SlideLatencies, 0.9f), GetPercentile(SlideLatencies, 0.99f),
+		GetPercentile(LedgeGrabLatencies, 0.5f), GetPercentile(LedgeGrabLatencies, 0.9f), GetPercentile(LedgeGrabLatencies, 0.99f),
+		LedgeGrabLatencies.Num());
+}
+
+APlayerBase* UPlayerNetTestComponent::GetPlayer() const
+{
+	return Cast<APlayerBase>(GetOwner());
+}
+
+void UPlayerNetTestComponent::UpdateSequence(float DeltaTime)
+{
+	const FNetTestInputStep& Step = NetTestSequence[StepIndex];
+	SetScriptedInput(Step.MoveInput, Step.bSprintInput, Step.bCrouchInput, Step.bJumpInput);
+
+	StepTime += DeltaTime;
+	if (StepTime < Step.Duration)
+		return;
+
+	StepTime = 0.0f;
+	StepIndex = (StepIndex + 1) % UE_ARRAY_COUNT(NetTestSequence);
+	if (StepIndex != 0 || --LoopsRemaining > 0)
+		return;
+
+	// Sequence finished, release all input and report
+	SetScriptedInput(FVector2D::ZeroVector, false, false, false);
+	LogReport();
+
+	if (FParse::Param(FCommandLine::Get(), TEXT("NetTestQuitWhenDone")))
+		FPlatformMisc::RequestExit(false);
+}
+
+void UPlayerNetTestComponent::SetScriptedInput(FVector2D MoveInput, bool bSprint, bool bCrouch, bool bJump)
+{
+	APlayerBase* Player = GetPlayer();
+	const FPlayerInputState& InputState = Player->GetInputState();
+
+	// Presses that start a locomotion state are timed until that state is entered
+	const double Now = FPlatformTime::Seconds();
+	if (bSprint && !InputState.IsHeld(EPlayerInputAction::Sprint))
+		SprintPressTime = Now;
+	if (bCrouch && !InputState.IsHeld(EPlayerInputAction::Crouch))
+		CrouchPressTime = Now;
+	if (bJump && !InputState.IsHeld(EPlayerInputAction::Jump))
+		JumpPressTime = Now;
+
+	// Go through the same edges as the input actions so the state machine sees scripted presses
+	if (!bJump && InputState.IsHeld(EPlayerInputAction::Jump))
+		Player->StopJumping();
+
+	Player->HotState.MoveInput = MoveInput;
+	Player->SetInputActionHeld(EPlayerInputAction::Sprint, bSprint);
+	Player->SetInputActionHeld(EPlayerInputAction::Crouch, bCrouch);
+	Player->SetInputActionHeld(EPlayerInputAction::Jump, bJump);
+}
+
+void UPlayerNetTestComponent::OnStateEnter(const FPlayerLocomotionEvent& Event)
+{
+	if (Event.Player.Get() != GetOwner())
+		return;
+
+	// Events are dispatched at the end of the frame the state changed in, which is included in the latency
+	const double Now = FPlatformTime::Seconds();
+	if (Event.State == EPlayerLocomotionState::Sprinting && SprintPressTime >= 0.0)
+	{
+		SprintLatencies.Add((Now - SprintPressTime) * 1000.0);
+		SprintPressTime = -1.0;
+	}
+	else if (Event.State == EPlayerLocomotionState::Sliding && CrouchPressTime >= 0.0)
+	{
+		SlideLatencies.Add((Now - CrouchPressTime) * 1000.0);
+		CrouchPressTime = -1.0;
+	}
+	else if (Event.State == EPlayerLocomotionState::LedgeGrabbing && JumpPressTime >= 0.0)
+	{
+		LedgeGrabLatencies.Add((Now - JumpPressTime) * 1000.0);
+		JumpPressTime = -1.0;
+	}
+}
@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "PlayerNetTestComponent.generated.h"
+
+class APlayerBase;
+struct FPlayerLocomotionEvent;
+
+/**
+ * Automated network test harness, only added to players in non-shipping builds started with -NetTestLoops=<loops> or -NetTestReport.
+ * On the owning client it drives the player through a scripted sprint/slide/ledge grab sequence and times each press to the state it starts.
+ * Both sides log a single NetTestReport line for Scripts/RunNetProfileMatrix.sh, the client when the sequence finishes and the server when the player leaves.
+ */
+UCLASS()
+class HORDESHOOTER_API UPlayerNetTestComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UPlayerNetTestComponent();
+
+	// Whether the command line asks for net testing at all
+	static bool IsRequested();
+
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	void StartSequence(int32 Loops);
+	void LogReport() const;
+
+private:
+	APlayerBase* GetPlayer() const;
+	void UpdateSequence(float DeltaTime);
+	void SetScriptedInput(FVector2D MoveInput, bool bSprint, bool bCrouch, bool bJump);
+	void OnStateEnter(const FPlayerLocomotionEvent& Event);
+
+private:
+	int32 LoopsRemaining = 0;
+	int32 StepIndex = 0;
+	float StepTime = 0.0f;
+	bool bSequenceStarted = false;
+
+	// When the scripted sequence last pressed each input, cleared once the state it starts is entered
+	double SprintPressTime = -1.0;
+	double CrouchPressTime = -1.0;
+	double JumpPressTime = -1.0;
+	TArray<float> SprintLatencies;
+	TArray<float> SlideLatencies;
+	TArray<float> LedgeGrabLatencies;
+
+	FDelegateHandle StateEnterHandle;
+};
@@ -0,0 +1,186 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Player/PlayerPawnPool.h"
+#include "Engine/World.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "Base/LagCompensationSubsystem.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPlayerPawnPool, Log, All);
+
+namespace
+{
+	float GetPercentile(TArray<float>& Samples, float Percentile)
+	{
+		if (Samples.IsEmpty())
+			return 0.0f;
+
+		Samples.Sort();
+		const int32 Index = FMath::Clamp(FMath::CeilToInt(Percentile * Samples.Num()) - 1, 0, Samples.Num() - 1);
+		return Samples[Index];
+	}
+
+	void LogSpawnLatencies(const TCHAR* Label, TArray<float>& Latencies)
+	{
+		UE_LOG(LogPlayerPawnPool, Display, TEXT("SpawnLatencyReport %s Spawns=%d Ms=%.3f/%.3f/%.3f Max=%.3f"),
+			Label, Latencies.Num(), GetPercentile(Latencies, 0.5f), GetPercentile(Latencies, 0.9f), GetPercentile(Latencies, 0.99f), GetPercentile(Latencies, 1.0f));
+	}
+}
+
+bool UPlayerPawnPoolSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	// Only the server spawns player pawns
+	const UWorld* World = Cast<UWorld>(Outer);
+	return Super::ShouldCreateSubsystem(Outer) && World && World->IsGameWorld() && World->GetNetMode() != NM_Client;
+}
+
+void UPlayerPawnPoolSubsystem::Deinitialize()
+{
+	Pools.Empty();
+	Super::Deinitialize();
+}
+
+void UPlayerPawnPoolSubsystem::Prewarm(TSubclassOf<APlayerBase> PawnClass, int32 Count)
+{
+	if (!PawnClass)
+		return;
+
+	FPlayerPawnPoolEntry& Pool = Pools.FindOrAdd(PawnClass);
+	Pool.Pawns.Reserve(Count);
+	while (Pool.Pawns.Num() < Count)
+	{
+		APlayerBase* Pawn = SpawnPooledPawn(PawnClass, FTransform::Identity);
+		if (!Pawn)
+			break;
+
+		DeactivatePawn(Pawn);
+		Pool.Pawns.Add(Pawn);
+	}
+}
+
+APlayerBase* UPlayerPawnPoolSubsystem::Acquire(TSubclassOf<APlayerBase> PawnClass, const FTransform& SpawnTransform)
+{
+	if (!PawnClass)
+		return nullptr;
+
+	// Pawns can still be destroyed from outside while pooled, e.g. by a level unload
+	if (FPlayerPawnPoolEntry* Pool = Pools.Find(PawnClass))
+	{
+		while (!Pool->Pawns.IsEmpty())
+		{
+			APlayerBase* Pawn = Pool->Pawns.Pop(EAllowShrinking::No);
+			if (IsValid(Pawn))
+			{
+				ActivatePawn(Pawn, SpawnTransform);
+				return Pawn;
+			}
+		}
+	}
+
+	APlayerBase* Pawn = SpawnPooledPawn(PawnClass, SpawnTransform);
+	if (Pawn)
+		ActivatePawn(Pawn, SpawnTransform);
+	return Pawn;
+}
+
+void UPlayerPawnPoolSubsystem::Release(APlayerBase* Pawn)
+{
+	if (!IsValid(Pawn))
+		return;
+
+	if (AController* PawnController = Pawn->GetController())
+		PawnController->UnPossess();
+
+	Pawn->ResetForReuse();
+	DeactivatePawn(Pawn);
+	Pools.FindOrAdd(Pawn->GetClass()).Pawns.Add(Pawn);
+}
+
+int32 UPlayerPawnPoolSubsystem::GetNumPooled(TSubclassOf<APlayerBase> PawnClass) const
+{
+	const FPlayerPawnPoolEntry* Pool = Pools.Find(PawnClass);
+	return Pool ? Pool->Pawns.Num() : 0;
+}
+
+void UPlayerPawnPoolSubsystem::BenchmarkSpawns(TSubclassOf<APlayerBase> PawnClass, int32 Count)
+{
+	if (!PawnClass || Count <= 0)
+		return;
+
+	// Spread out so the spawns do not have to resolve overlaps with each other
+	auto GetSpawnTransform = [](int32 Index) { return FTransform(FVector((Index % 10) * 150.0f, (Index / 10) * 150.0f, 200.0f)); };
+
+	TArray<float> Latencies;
+	Latencies.Reserve(Count);
+	TArray<APlayerBase*> Pawns;
+	Pawns.Reserve(Count);
+
+	// Before, every spawn constructs a new pawn
+	for (int32 i = 0; i < Count; i++)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		APlayerBase* Pawn = SpawnPooledPawn(PawnClass, GetSpawnTransform(i));
+		Latencies.Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+		if (Pawn)
+			Pawns.Add(Pawn);
+	}
+	LogSpawnLatencies(TEXT("Fresh"), Latencies);
+
+	// After, the same pawns go back to the pool and come out again
+	for (APlayerBase* Pawn : Pawns)
+		Release(Pawn);
+
+	Latencies.Reset();
+	const int32 NumPooledSpawns = Pawns.Num();
+	Pawns.Reset();
+	for (int32 i = 0; i < NumPooledSpawns; i++)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		APlayerBase* Pawn = Acquire(PawnClass, GetSpawnTransform(i));
+		Latencies.Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+		if (Pawn)
+			Pawns.Add(Pawn);
+	}
+	LogSpawnLatencies(TEXT("Pooled"), Latencies);
+
+	for (APlayerBase* Pawn : Pawns)
+		Release(Pawn);
+}
+
+APlayerBase* UPlayerPawnPoolSubsystem::SpawnPooledPawn(TSubclassOf<APlayerBase> PawnClass, const FTransform& SpawnTransform)
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	return GetWorld()->SpawnActor<APlayerBase>(PawnClass, SpawnTransform, SpawnParams);
+}
+
+void UPlayerPawnPoolSubsystem::ActivatePawn(APlayerBase* Pawn, const FTransform& SpawnTransform)
+{
+	Pawn->SetActorTransform(SpawnTransform, false, nullptr, ETeleportType::ResetPhysics);
+	Pawn->SetActorHiddenInGame(false);
+	Pawn->SetActorEnableCollision(true);
+	Pawn->SetActorTickEnabled(true);
+	Pawn->GetCharacterMovement()->Activate(true);
+	Pawn->GetCharacterMovement()->SetDefaultMovementMode();
+	Pawn->SetReplicates(true);
+
+	if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+		LagCompensation->Register(Pawn->GetCapsuleComponent());
+}
+
+void UPlayerPawnPoolSubsystem::DeactivatePawn(APlayerBase* Pawn)
+{
+	// Rewinds must not see a pawn that is not in the game, and its history would blend across the respawn
+	if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+		LagCompensation->Unregister(Pawn->GetCapsuleComponent());
+
+	// Closes the actor channels, clients destroy their copy
+	Pawn->SetReplicates(false);
+	Pawn->GetCharacterMovement()->StopMovementImmediately();
+	Pawn->GetCharacterMovement()->Deactivate();
+	Pawn->SetActorTickEnabled(false);
+	Pawn->SetActorEnableCollision(false);
+	Pawn->SetActorHiddenInGame(true);
+}
\ No newline at end of file
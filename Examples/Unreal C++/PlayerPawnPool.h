@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Player/PlayerBase.h"
+#include "PlayerPawnPool.generated.h"
+
+USTRUCT()
+struct FPlayerPawnPoolEntry
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<APlayerBase>> Pawns;
+};
+
+/**
+ * Server side pool of player pawns so respawns can reuse a dormant pawn instead of constructing a new one.
+ * Nothing takes pawns from it by default, a game mode opts in by calling Acquire where it would spawn a pawn and Release where it would destroy one.
+ * Pooled pawns are hidden, have no collision or ticks and are not replicated, clients create their copy when a pawn is taken.
+ */
+UCLASS()
+class HORDESHOOTER_API UPlayerPawnPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+
+	// Fills the pool up to Count pawns of PawnClass, meant for loading screens and match start since each one is a full spawn
+	void Prewarm(TSubclassOf<APlayerBase> PawnClass, int32 Count);
+
+	// A pooled pawn of PawnClass moved to SpawnTransform, or a newly spawned one when the pool is empty
+	APlayerBase* Acquire(TSubclassOf<APlayerBase> PawnClass, const FTransform& SpawnTransform);
+	// Unpossesses the pawn and puts it to sleep until the next Acquire
+	void Release(APlayerBase* Pawn);
+
+	int32 GetNumPooled(TSubclassOf<APlayerBase> PawnClass) const;
+
+	// Logs spawn latency percentiles for Count fresh spawns, then for Count acquires from a prewarmed pool
+	void BenchmarkSpawns(TSubclassOf<APlayerBase> PawnClass, int32 Count);
+
+private:
+	APlayerBase* SpawnPooledPawn(TSubclassOf<APlayerBase> PawnClass, const FTransform& SpawnTransform);
+	void ActivatePawn(APlayerBase* Pawn, const FTransform& SpawnTransform);
+	void DeactivatePawn(APlayerBase* Pawn);
+
+private:
+	UPROPERTY(Transient)
+	TMap<TSubclassOf<APlayerBase>, FPlayerPawnPoolEntry> Pools;
+};
@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Player/PlayerPhysicsProbe.h"
+#include "Engine/World.h"
+#include "Components/PrimitiveComponent.h"
+
+void FPlayerPhysicsProbe::Init(const AActor* Owner, ECollisionChannel InTraceChannel, const UPrimitiveComponent* PawnComponent)
+{
+	TraceChannel = InTraceChannel;
+
+	TraceParams = FCollisionQueryParams(SCENE_QUERY_STAT(PlayerProbeSweep), true, Owner);
+	OverlapParams = FCollisionQueryParams(SCENE_QUERY_STAT(PlayerProbeOverlap), false, Owner);
+	StaticObjectParams = FCollisionObjectQueryParams(ECC_WorldStatic);
+
+	if (PawnComponent)
+	{
+		PawnChannel = PawnComponent->GetCollisionObjectType();
+		PawnResponseParams = FCollisionResponseParams(PawnComponent->GetCollisionResponseToChannels());
+	}
+}
+
+bool FPlayerPhysicsProbe::Sweep(const UWorld* World, const FVector& Start, const FVector& End, const FQuat& Rotation, const FCollisionShape& Shape, FHitResult& OutHit) const
+{
+	return World->SweepSingleByChannel(OutHit, Start, End, Rotation, TraceChannel, Shape, TraceParams);
+}
+
+bool FPlayerPhysicsProbe::OverlapAnyStatic(const UWorld* World, const FVector& Location, const FQuat& Rotation, const FCollisionShape& Shape) const
+{
+	return World->OverlapAnyTestByObjectType(Location, Rotation, StaticObjectParams, Shape, OverlapParams);
+}
+
+FTraceHandle FPlayerPhysicsProbe::AsyncOverlapPawn(UWorld* World, const FVector& Location, const FQuat& Rotation, const FCollisionShape& Shape, const FOverlapDelegate* Delegate) const
+{
+	return World->AsyncOverlapByChannel(Location, Rotation, PawnChannel, Shape, OverlapParams, PawnResponseParams, Delegate);
+}
\ No newline at end of file
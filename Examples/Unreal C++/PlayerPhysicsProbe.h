@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CollisionQueryParams.h"
+#include "CollisionShape.h"
+#include "WorldCollision.h"
+
+class UPrimitiveComponent;
+
+/**
+ * Collision query parameters a pawn's gameplay probes (ledge checks and the like) reuse for every query.
+ * Built once per pawn and calls the world query API directly, so probes do not allocate.
+ */
+struct HORDESHOOTER_API FPlayerPhysicsProbe
+{
+	// PawnComponent supplies the channel and responses pawn overlaps are tested with, usually the capsule
+	void Init(const AActor* Owner, ECollisionChannel InTraceChannel, const UPrimitiveComponent* PawnComponent);
+
+	// Sweep against the trace channel, complex collision
+	bool Sweep(const UWorld* World, const FVector& Start, const FVector& End, const FQuat& Rotation, const FCollisionShape& Shape, FHitResult& OutHit) const;
+	// Any world static geometry overlapping the shape
+	bool OverlapAnyStatic(const UWorld* World, const FVector& Location, const FQuat& Rotation, const FCollisionShape& Shape) const;
+	// Queues an overlap against whatever blocks the pawn, the delegate gets the result next frame
+	FTraceHandle AsyncOverlapPawn(UWorld* World, const FVector& Location, const FQuat& Rotation, const FCollisionShape& Shape, const FOverlapDelegate* Delegate) const;
+
+	ECollisionChannel TraceChannel = ECC_Visibility;
+	FCollisionQueryParams TraceParams;
+	FCollisionQueryParams OverlapParams;
+	FCollisionObjectQueryParams StaticObjectParams;
+	ECollisionChannel PawnChannel = ECC_Pawn;
+	FCollisionResponseParams PawnResponseParams;
+};
@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+"""
+Aggregates movement correction logs (Saved/Telemetry/Corrections_*.bin, written with -CorrectionLog) into
+per-map heatmaps and per-locomotion-state correction rates.
+
+Server records give where and in which state corrections happened, StateTime records give how long players
+spent in each state, and client records matched to server records by player and timestamp show when the two
+sides disagreed about the state.
+
+Usage: AggregateCorrections.py <log or directory>... [--cell-size 500] [--out-dir CorrectionReport]
+"""
+
+import argparse
+import collections
+import csv
+import math
+import os
+import struct
+import sys
+
+MAGIC = 0x434D5348
+VERSION = 3
+HEADER = struct.Struct("<IIII")
+# Mirrors FMovementCorrectionRecord in MovementCorrectionLog.h
+RECORD = struct.Struct("<fff3f3ffiHBBBBxx")
+
+RECORD_SERVER, RECORD_CLIENT, RECORD_STATE_TIME = 0, 1, 2
+LOCOMOTION_STATES = ["Idle", "Moving", "Sprinting", "CrouchIdle", "CrouchMoving", "Sliding", "LedgeGrabbing", "Falling"]
+MOVEMENT_MODES = ["None", "Walking", "NavWalking", "Falling", "Swimming", "Flying", "Custom"]
+CUSTOM_MOVEMENT_MODES = ["None", "LedgeGrab", "Slide"]
+BLOCKERS = ["Movement", "Look", "Sprint", "Crouch", "Slide", "Jump", "Interact", "ToggleFlashlight",
+	"PrimaryFire", "SecondaryFire", "Reload", "AimDownSights", "WeaponSwap"]
+
+
+def name_of(names, index):
+	return names[index] if index < len(names) else str(index)
+
+
+def movement_mode_name(mode, custom_mode):
+	if name_of(MOVEMENT_MODES, mode) == "Custom":
+		return name_of(CUSTOM_MOVEMENT_MODES, custom_mode)
+	return name_of(MOVEMENT_MODES, mode)
+
+
+def read_log(path):
+	with open(path, "rb") as file:
+		data = file.read()
+
+	magic, version, record_size, map_name_length = HEADER.unpack_from(data, 0)
+	if magic != MAGIC or version != VERSION or record_size != RECORD.size:
+		raise ValueError(f"{path}: not a version {VERSION} correction log")
+
+	offset = HEADER.size
+	map_name = data[offset:offset + map_name_length].decode("utf-8")
+	offset += map_name_length
+
+	records = []
+	# A log cut off mid write can end in a partial record
+	for values in RECORD.iter_unpack(data[offset:offset + (len(data) - offset) // RECORD.size * RECORD.size]):
+		time, client_time_stamp, duration, lx, ly, lz, ex, ey, ez, speed_modifier, player_id, blocker_mask, record_type, state, mode, custom_mode = values
+		records.append({
+			"type": record_type, "time": time, "client_time_stamp": client_time_stamp, "duration": duration,
+			"location": (lx, ly, lz), "error": math.sqrt(ex * ex + ey * ey + ez * ez),
+			"speed_modifier": speed_modifier, "player_id": player_id,
+			"blocker_mask": blocker_mask, "state": state, "mode": mode, "custom_mode": custom_mode,
+		})
+	return map_name, records
+
+
+def find_logs(paths):
+	for path in paths:
+		if os.path.isdir(path):
+			for name in sorted(os.listdir(path)):
+				if name.startswith("Corrections_") and name.endswith(".bin"):
+					yield os.path.join(path, name)
+		else:
+			yield path
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Aggregate movement correction logs into heatmaps and per-state rates.")
+	parser.add_argument("logs", nargs="+", help="Correction logs or directories containing them")
+	parser.add_argument("--cell-size", type=float, default=500.0, help="Heatmap cell size in world units")
+	parser.add_argument("--out-dir", default="CorrectionReport", help="Where the heatmap CSVs are written")
+	args = parser.parse_args()
+
+	server_records = collections.defaultdict(list)
+	client_records = collections.defaultdict(list)
+	state_seconds = collections.defaultdict(lambda: collections.Counter())
+	for path in find_logs(args.logs):
+		try:
+			map_name, records = read_log(path)
+		except (ValueError, struct.error) as error:
+			print(error, file=sys.stderr)
+			continue
+		for record in records:
+			if record["type"] == RECORD_SERVER:
+				server_records[map_name].append(record)
+			elif record["type"] == RECORD_CLIENT:
+				client_records[map_name].append(record)
+			elif record["type"] == RECORD_STATE_TIME:
+				state_seconds[map_name][record["state"]] += record["duration"]
+
+	if not server_records and not client_records:
+		print("No corrections found")
+		return
+
+	os.makedirs(args.out_dir, exist_ok=True)
+	for map_name in sorted(set(server_records) | set(client_records)):
+		corrections = server_records[map_name]
+		print(f"=== {map_name}: {len(corrections)} server corrections, {len(client_records[map_name])} client corrections ===")
+
+		# Heatmap, corrections per cell on the XY plane
+		cells = collections.defaultdict(list)
+		for record in corrections:
+			x, y, _ = record["location"]
+			cells[(math.floor(x / args.cell_size), math.floor(y / args.cell_size))].append(record["error"])
+		heatmap_path = os.path.join(args.out_dir, f"heatmap_{map_name}.csv")
+		with open(heatmap_path, "w", newline="") as file:
+			writer = csv.writer(file)
+			writer.writerow(["cell_x", "cell_y", "min_x", "min_y", "corrections", "mean_error", "max_error"])
+			for (cx, cy), errors in sorted(cells.items(), key=lambda item: -len(item[1])):
+				writer.writerow([cx, cy, cx * args.cell_size, cy * args.cell_size, len(errors), f"{sum(errors) / len(errors):.1f}", f"{max(errors):.1f}"])
+		print(f"Heatmap: {heatmap_path}")
+		for (cx, cy), errors in sorted(cells.items(), key=lambda item: -len(item[1]))[:5]:
+			print(f"  cell ({cx * args.cell_size:.0f}, {cy * args.cell_size:.0f}): {len(errors)} corrections, mean error {sum(errors) / len(errors):.1f}")
+
+		# Correction rates per server side locomotion state
+		by_state = collections.Counter(record["state"] for record in corrections)
+		print(f"  {'State':<14} {'Corrections':>11} {'Seconds':>10} {'Per minute':>10}")
+		for state in sorted(set(by_state) | set(state_seconds[map_name])):
+			seconds = state_seconds[map_name][state]
+			rate = f"{by_state[state] / seconds * 60.0:.2f}" if seconds > 0 else "-"
+			print(f"  {name_of(LOCOMOTION_STATES, state):<14} {by_state[state]:>11} {seconds:>10.1f} {rate:>10}")
+
+		by_mode = collections.Counter(movement_mode_name(record["mode"], record["custom_mode"]) for record in corrections)
+		print("  Movement modes: " + ", ".join(f"{mode} {count}" for mode, count in by_mode.most_common()))
+
+		by_blocker = collections.Counter(name_of(BLOCKERS, bit) for record in corrections for bit in range(16) if record["blocker_mask"] & (1 << bit))
+		if by_blocker:
+			print("  Active blockers: " + ", ".join(f"{blocker} {count}" for blocker, count in by_blocker.most_common()))
+		with_modifiers = sum(1 for record in corrections if abs(record["speed_modifier"] - 1.0) > 1e-3)
+		print(f"  With speed modifiers active: {with_modifiers}")
+
+		# The same correction seen from both sides, where the client thought it was in a different state
+		server_states = {(record["player_id"], round(record["client_time_stamp"], 4)): record["state"] for record in corrections}
+		mismatches = collections.Counter()
+		for record in client_records[map_name]:
+			server_state = server_states.get((record["player_id"], round(record["client_time_stamp"], 4)))
+			if server_state is not None and server_state != record["state"]:
+				mismatches[(name_of(LOCOMOTION_STATES, record["state"]), name_of(LOCOMOTION_STATES, server_state))] += 1
+		if mismatches:
+			print("  State mismatches (client -> server): " + ", ".join(f"{client}->{server} {count}" for (client, server), count in mismatches.most_common()))
+
+
+if __name__ == "__main__":
+	main()
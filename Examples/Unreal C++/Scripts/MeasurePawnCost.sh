@@ -0,0 +1,35 @@
+#!/usr/bin/env bash
+# Starts a headless dedicated server, spawns N AI controlled player pawns (-MeasurePawnCost=N) and prints the
+# memory and actor tick time each pawn adds. Run it against a server build (cosmetic components compiled out)
+# and a regular build started with -server (cosmetic components dormant) to compare the two profiles.
+#
+# Usage: MeasurePawnCost.sh <path to HordeShooterServer binary> <map> [pawns] [timeout seconds]
+
+set -euo pipefail
+
+SERVER_BINARY="${1:?Path to the server binary is required}"
+MAP="${2:?Map name is required}"
+PAWNS="${3:-100}"
+TIMEOUT_SECONDS="${4:-180}"
+
+PORT="${PORT:-17777}"
+LOG_DIR="${LOG_DIR:-$(pwd)/PawnCostLogs}"
+LOG="$LOG_DIR/Server_${PAWNS}.log"
+mkdir -p "$LOG_DIR"
+rm -f "$LOG"
+
+"$SERVER_BINARY" "$MAP" -server -unattended -port="$PORT" -MeasurePawnCost="$PAWNS" -abslog="$LOG" >/dev/null 2>&1 &
+SERVER_PID=$!
+trap 'kill "$SERVER_PID" 2>/dev/null || true' EXIT
+
+echo "Measuring ${PAWNS} pawns, log in $LOG"
+for ((i = 0; i < TIMEOUT_SECONDS; i++)); do
+	if grep -q "PawnCostReport" "$LOG" 2>/dev/null; then
+		grep -h "PawnCostReport" "$LOG" | sed -e 's/.*PawnCostReport /  /'
+		exit 0
+	fi
+	sleep 1
+done
+
+echo "No report after ${TIMEOUT_SECONDS}s, see $LOG" >&2
+exit 1
@@ -0,0 +1,54 @@
+#!/usr/bin/env bash
+# Launches N packed HordeShooter dedicated servers from one staged build and reports per-instance memory.
+# RSS counts shared pages in every process, PSS splits them between the processes mapping them,
+# so the PSS of each added instance is what it actually costs the host.
+#
+# Usage: MeasureServerRSS.sh <path to HordeShooterServer binary> <map> [instances] [settle seconds]
+
+set -euo pipefail
+
+SERVER_BINARY="${1:?Path to the staged server binary is required}"
+MAP="${2:?Map name is required}"
+INSTANCES="${3:-4}"
+SETTLE_SECONDS="${4:-60}"
+
+PIDS=()
+cleanup()
+{
+	for PID in "${PIDS[@]}"; do
+		kill "$PID" 2>/dev/null || true
+	done
+}
+trap cleanup EXIT
+
+for ((i = 0; i < INSTANCES; i++)); do
+	"$SERVER_BINARY" "$MAP" -server -log -unattended -PackedServer -ServerInstance="$i" >/dev/null 2>&1 &
+	PIDS+=("$!")
+done
+
+echo "Waiting ${SETTLE_SECONDS}s for ${INSTANCES} instances to load..."
+sleep "$SETTLE_SECONDS"
+
+printf "%-10s %-10s %12s %12s %14s\n" "Instance" "PID" "RSS (MB)" "PSS (MB)" "Shared (MB)"
+TOTAL_RSS=0
+TOTAL_PSS=0
+for ((i = 0; i < INSTANCES; i++)); do
+	PID="${PIDS[$i]}"
+	if [[ ! -r "/proc/$PID/smaps_rollup" ]]; then
+		printf "%-10s %-10s %12s\n" "$i" "$PID" "exited"
+		continue
+	fi
+
+	RSS_KB=$(awk '/^Rss:/ { print $2 }' "/proc/$PID/smaps_rollup")
+	PSS_KB=$(awk '/^Pss:/ { print $2 }' "/proc/$PID/smaps_rollup")
+	SHARED_KB=$(awk '/^Shared_(Clean|Dirty):/ { Sum += $2 } END { print Sum }' "/proc/$PID/smaps_rollup")
+	TOTAL_RSS=$((TOTAL_RSS + RSS_KB))
+	TOTAL_PSS=$((TOTAL_PSS + PSS_KB))
+
+	printf "%-10s %-10s %12.1f %12.1f %14.1f\n" "$i" "$PID" "$(bc -l <<< "$RSS_KB / 1024")" "$(bc -l <<< "$PSS_KB / 1024")" "$(bc -l <<< "$SHARED_KB / 1024")"
+done
+
+echo
+printf "Total RSS: %.1f MB\n" "$(bc -l <<< "$TOTAL_RSS / 1024")"
+printf "Total PSS: %.1f MB (actual host memory used by all instances)\n" "$(bc -l <<< "$TOTAL_PSS / 1024")"
+printf "Average PSS per instance: %.1f MB\n" "$(bc -l <<< "$TOTAL_PSS / 1024 / $INSTANCES")"
@@ -0,0 +1,54 @@
+#!/usr/bin/env bash
+# Runs a listen server and N headless clients through the scripted net test sequence under Linux perf, then reports
+# cache misses for the whole client process (perf stat) and the share attributed to APlayerBase (perf record).
+# Compare runs on two builds to measure layout changes to per-tick data.
+#
+# Usage: PerfCacheMisses.sh <path to HordeShooter binary> <map> [clients] [loops]
+
+set -euo pipefail
+
+GAME_BINARY="${1:?Path to the game binary is required}"
+MAP="${2:?Map name is required}"
+CLIENTS="${3:-4}"
+LOOPS="${4:-10}"
+PORT="${PORT:-17777}"
+OUT_DIR="${OUT_DIR:-$(pwd)/PerfCacheMisses}"
+EVENTS="cache-references,cache-misses,L1-dcache-loads,L1-dcache-load-misses,LLC-loads,LLC-load-misses"
+
+command -v perf >/dev/null || { echo "perf is required" >&2; exit 1; }
+mkdir -p "$OUT_DIR"
+
+"$GAME_BINARY" "$MAP?listen" -game -nullrhi -unattended -port="$PORT" -abslog="$OUT_DIR/Server.log" >/dev/null 2>&1 &
+SERVER_PID=$!
+trap 'kill "$SERVER_PID" 2>/dev/null || true' EXIT
+sleep 15
+
+# The server runs every client's pawn as well, so its counters cover the authority side of the same sequence
+perf stat -e "$EVENTS" -p "$SERVER_PID" -o "$OUT_DIR/ServerStat.txt" &
+SERVER_STAT_PID=$!
+
+CLIENT_PIDS=()
+for ((i = 0; i < CLIENTS; i++)); do
+	perf stat -e "$EVENTS" -o "$OUT_DIR/Client${i}Stat.txt" \
+		"$GAME_BINARY" "127.0.0.1:$PORT" -game -nullrhi -nosound -unattended -NetTestLoops="$LOOPS" -NetTestQuitWhenDone \
+		-abslog="$OUT_DIR/Client$i.log" >/dev/null 2>&1 &
+	CLIENT_PIDS+=("$!")
+done
+
+# Sample where the first client's misses land
+sleep 10
+perf record -e cache-misses -g -o "$OUT_DIR/Client0.perf.data" -p "$(pgrep -n -f "abslog=$OUT_DIR/Client0.log")" -- sleep 20 || true
+
+for PID in "${CLIENT_PIDS[@]}"; do
+	wait "$PID" || true
+done
+kill -INT "$SERVER_STAT_PID" 2>/dev/null || true
+wait "$SERVER_STAT_PID" 2>/dev/null || true
+
+for STAT in "$OUT_DIR"/*Stat.txt; do
+	echo "=== $(basename "$STAT" .txt) ==="
+	grep -E "cache|LLC|L1" "$STAT" || true
+done
+
+echo "=== APlayerBase share of sampled cache misses (Client0) ==="
+perf report -i "$OUT_DIR/Client0.perf.data" --no-children --sort symbol --stdio 2>/dev/null | grep -E "APlayerBase|CustomCharacterMovement" | head -20 || true
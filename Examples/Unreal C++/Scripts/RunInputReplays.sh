@@ -0,0 +1,47 @@
+#!/usr/bin/env bash
+# Starts a dedicated server and one headless client per input recording, each replaying its recording
+# (-ReplayInput) against the server and quitting when it runs out. Recordings are made with -RecordInput=<name>
+# or the StartInputRecording/StopInputRecording console commands and are replayed one frame per client frame,
+# so clients run at a fixed frame rate to reproduce the recorded session. Relative recording names are looked up
+# in each client's Saved/InputRecordings. Each client records a memory allocation trace next to its log for
+# Unreal Insights (Memory Insights).
+#
+# Usage: RunInputReplays.sh <path to HordeShooterServer binary> <path to HordeShooter binary> <map> <recording>...
+
+set -euo pipefail
+
+SERVER_BINARY="${1:?Path to the server binary is required}"
+GAME_BINARY="${2:?Path to the game binary is required}"
+MAP="${3:?Map name is required}"
+shift 3
+RECORDINGS=("$@")
+if [[ ${#RECORDINGS[@]} -eq 0 ]]; then
+	echo "At least one recording is required" >&2
+	exit 1
+fi
+
+PORT="${PORT:-17777}"
+FPS="${FPS:-60}"
+LOG_DIR="${LOG_DIR:-$(pwd)/InputReplayLogs}"
+mkdir -p "$LOG_DIR"
+
+"$SERVER_BINARY" "$MAP" -server -unattended -port="$PORT" -abslog="$LOG_DIR/Server.log" >/dev/null 2>&1 &
+SERVER_PID=$!
+trap 'kill "$SERVER_PID" 2>/dev/null || true' EXIT
+sleep 15
+
+CLIENT_PIDS=()
+for RECORDING in "${RECORDINGS[@]}"; do
+	NAME=$(basename "$RECORDING" .hsinput)
+	"$GAME_BINARY" "127.0.0.1:$PORT" -game -nullrhi -nosound -unattended -benchmark -fps="$FPS" \
+		-ReplayInput="$RECORDING" -ReplayQuitWhenDone -trace=default,memalloc -tracefile="$LOG_DIR/Client_$NAME.utrace" -abslog="$LOG_DIR/Client_$NAME.log" >/dev/null 2>&1 &
+	CLIENT_PIDS+=("$!")
+done
+
+echo "Replaying ${#RECORDINGS[@]} recordings against the server, logs in $LOG_DIR"
+for PID in "${CLIENT_PIDS[@]}"; do
+	wait "$PID" || true
+done
+
+grep -h "Input replay" "$LOG_DIR"/Client_*.log || echo "No replay output found, see $LOG_DIR"
+echo "Allocation traces: $LOG_DIR/Client_*.utrace"
@@ -0,0 +1,58 @@
+#!/usr/bin/env bash
+# Runs a listen server and N clients on localhost for each network profile, drives every client through the
+# scripted sprint/slide/ledge grab sequence (UPlayerNetTestComponent) and summarizes the NetTestReport lines.
+# Clients record a memory allocation trace next to their log, open it in Unreal Insights (Memory Insights) to compare
+# allocations per frame between builds.
+#
+# Usage: RunNetProfileMatrix.sh <path to HordeShooter binary> <map> [clients] [loops]
+
+set -euo pipefail
+
+GAME_BINARY="${1:?Path to the game binary is required}"
+MAP="${2:?Map name is required}"
+CLIENTS="${3:-2}"
+LOOPS="${4:-5}"
+PORT=17777
+LOG_DIR="${LOG_DIR:-$(pwd)/NetProfileLogs}"
+
+# Name PktLag PktLagVariance PktLoss PktOrder
+PROFILES=(
+	"LAN 0 0 0 0"
+	"Broadband 40 5 0 0"
+	"Transatlantic 120 15 1 0"
+	"Mobile 180 40 3 1"
+	"Bad 250 60 8 1"
+)
+
+mkdir -p "$LOG_DIR"
+
+for PROFILE in "${PROFILES[@]}"; do
+	read -r NAME LAG VARIANCE LOSS ORDER <<< "$PROFILE"
+	echo "=== $NAME (PktLag=$LAG PktLagVariance=$VARIANCE PktLoss=$LOSS PktOrder=$ORDER) ==="
+
+	NET_ARGS="-PktLag=$LAG -PktLagVariance=$VARIANCE -PktLoss=$LOSS -PktOrder=$ORDER"
+	SERVER_LOG="$LOG_DIR/${NAME}_Server.log"
+	"$GAME_BINARY" "$MAP?listen" -game -nullrhi -unattended -port="$PORT" -NetTestReport -NetAccounting $NET_ARGS -abslog="$SERVER_LOG" >/dev/null 2>&1 &
+	SERVER_PID=$!
+	sleep 15
+
+	CLIENT_PIDS=()
+	for ((i = 0; i < CLIENTS; i++)); do
+		"$GAME_BINARY" "127.0.0.1:$PORT" -game -nullrhi -unattended -NetTestLoops="$LOOPS" -NetTestQuitWhenDone $NET_ARGS \
+			-trace=default,memalloc -tracefile="$LOG_DIR/${NAME}_Client$i.utrace" -abslog="$LOG_DIR/${NAME}_Client$i.log" >/dev/null 2>&1 &
+		CLIENT_PIDS+=("$!")
+	done
+
+	for PID in "${CLIENT_PIDS[@]}"; do
+		wait "$PID" || true
+	done
+
+	# Give the server a moment to log the reports of the disconnected players
+	sleep 5
+	kill "$SERVER_PID" 2>/dev/null || true
+	wait "$SERVER_PID" 2>/dev/null || true
+
+	grep -h "NetTestReport" "$LOG_DIR/${NAME}"_*.log | sed -e 's/.*NetTestReport /  /' || echo "  No reports found, see $LOG_DIR"
+	echo "  Allocation traces: $LOG_DIR/${NAME}_Client*.utrace"
+	PORT=$((PORT + 1))
+done
@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Base/TransformHistory.h"
+
+FTransformHistory::FTransformHistory(int32 Capacity)
+{
+	Samples.SetNum(FMath::Max(Capacity, 2));
+}
+
+void FTransformHistory::Record(double Time, const FTransform& Transform)
+{
+	if (NumSamples < Samples.Num())
+	{
+		Samples[(Head + NumSamples) % Samples.Num()] = { Time, Transform };
+		NumSamples++;
+		return;
+	}
+
+	// Full, overwrite the oldest
+	Samples[Head] = { Time, Transform };
+	Head = (Head + 1) % Samples.Num();
+}
+
+bool FTransformHistory::Sample(double Time, FTransform& OutTransform) const
+{
+	if (NumSamples == 0)
+		return false;
+
+	if (Time <= GetSample(0).Time)
+	{
+		OutTransform = GetSample(0).Transform;
+		return true;
+	}
+
+	// Rewinds are usually recent, search from the newest sample back
+	for (int32 i = NumSamples - 1; i >= 0; i--)
+	{
+		const FSample& Before = GetSample(i);
+		if (Before.Time > Time)
+			continue;
+
+		if (i == NumSamples - 1)
+		{
+			OutTransform = Before.Transform;
+			return true;
+		}
+
+		const FSample& After = GetSample(i + 1);
+		const double Alpha = (Time - Before.Time) / FMath::Max(After.Time - Before.Time, UE_DOUBLE_SMALL_NUMBER);
+		OutTransform.Blend(Before.Transform, After.Transform, (float)Alpha);
+		return true;
+	}
+
+	OutTransform = GetSample(0).Transform;
+	return true;
+}
+
+void FTransformHistory::Reset()
+{
+	Head = 0;
+	NumSamples = 0;
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Fixed size ring buffer of timestamped transforms, the oldest samples are overwritten once it is full.
+ * Allocates once on construction.
+ */
+struct HORDESHOOTER_API FTransformHistory
+{
+	explicit FTransformHistory(int32 Capacity = 64);
+
+	// Times must not go backwards
+	void Record(double Time, const FTransform& Transform);
+	// Transform at Time blended between the samples either side of it, clamped to the oldest and newest. False if empty
+	bool Sample(double Time, FTransform& OutTransform) const;
+	void Reset();
+
+private:
+	struct FSample
+	{
+		double Time;
+		FTransform Transform;
+	};
+
+	// Index 0 is the oldest sample
+	const FSample& GetSample(int32 Index) const { return Samples[(Head + Index) % Samples.Num()]; }
+
+	TArray<FSample> Samples;
+	int32 Head = 0;
+	int32 NumSamples = 0;
+};